@@ -0,0 +1,109 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+using namespace std;
+
+/**
+ * @enum BreakerState
+ * @brief 断路器状态
+ */
+enum class BreakerState
+{
+    Closed = 0,     ///< 正常：借用方可以等待新连接
+    Open,           ///< 断开：后端不可用，没有空闲连接时借用立即失败，暂停建连
+    HalfOpen        ///< 半开：冷却结束，正在用一次建连探测后端是否恢复
+};
+
+/**
+ * @brief 断路器状态的名称
+ */
+const char* breakerStateName(BreakerState state);
+
+/**
+ * @struct BreakerStats
+ * @brief 断路器统计
+ */
+struct BreakerStats
+{
+    BreakerState state = BreakerState::Closed;
+    int consecutiveFailures = 0;    // 当前连续建连失败次数
+    uint64_t opens = 0;             // 累计断开次数
+    uint64_t rejected = 0;          // 断开期间被立即拒绝的借用请求数
+};
+
+/**
+ * @class CircuitBreaker
+ * @brief 后端建连断路器
+ *
+ * @details 按建连结果切换状态：
+ *          - Closed：连续failure_threshold次建连失败后断开
+ *          - Open：经过open_time冷却后，第一个tryBeginProbe()的调用方进入半开并执行探测
+ *          - HalfOpen：探测成功则闭合，失败则重新断开并重新计时
+ *          任何状态下建连成功都会闭合断路器(例如断开前发起、较晚完成的握手)
+ *
+ * @note 借用路径只做一次relaxed原子读取(allowRequests)；状态切换很少发生，由互斥锁串行化
+ */
+class CircuitBreaker
+{
+public:
+    CircuitBreaker() = default;
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    /**
+     * @brief 设置参数
+     * @param failureThreshold 断开前允许的连续失败次数，0表示禁用断路器
+     * @param openTime 断开后到允许探测的冷却时间
+     */
+    void configure(int failureThreshold, chrono::milliseconds openTime);
+
+    /**
+     * @brief 当前状态
+     */
+    BreakerState state() const { return static_cast<BreakerState>(_state.load(memory_order_relaxed)); }
+
+    /**
+     * @brief 借用方是否可以等待新连接(仅Closed状态)
+     */
+    bool allowRequests() const { return _state.load(memory_order_relaxed) == static_cast<int>(BreakerState::Closed); }
+
+    /**
+     * @brief 冷却结束时进入半开状态，只有一个调用方会得到true并负责执行探测
+     */
+    bool tryBeginProbe();
+
+    /**
+     * @brief 允许探测的时间(仅Open状态有意义)
+     */
+    chrono::steady_clock::time_point retryAt() const;
+
+    /**
+     * @brief 记录一次建连成功
+     * @return bool 断路器因此由Open/HalfOpen闭合时返回true
+     */
+    bool onSuccess();
+
+    /**
+     * @brief 记录一次建连失败
+     * @return bool 断路器因此断开(含半开探测失败后重新断开)时返回true
+     */
+    bool onFailure();
+
+    /**
+     * @brief 获取统计(rejected由连接池填写)
+     */
+    BreakerStats stats() const;
+
+private:
+    void openLocked();
+
+    mutable mutex _mutex;                   // 串行化状态切换
+    int _threshold = 0;                     // 0表示禁用
+    chrono::milliseconds _openTime{0};
+    atomic_int _state{static_cast<int>(BreakerState::Closed)};
+    atomic_int _failures{0};                // 连续失败次数
+    atomic<uint64_t> _opens{0};             // 累计断开次数
+    chrono::steady_clock::time_point _retryAt;  // 受_mutex保护
+};
@@ -1,6 +1,5 @@
 #pragma once
 #include <string>
-#include <queue>
 #include <mutex>
 #include <iostream>
 #include <atomic>
@@ -8,26 +7,244 @@
 #include <condition_variable>
 #include <memory>
 #include <functional>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#if __cplusplus >= 202002L
+#include <coroutine>
+#endif
 using namespace std;
 #include "Connection.h"
+#include "IdleStore.h"
+#include "ConnectionSlab.h"
+#include "PoolConfig.h"
+#include "ConnectionFactory.h"
+#include "TimerQueue.h"
+#include "CircuitBreaker.h"
+#include "TokenBucket.h"
+
+/**
+ * @enum BorrowPriority
+ * @brief 借用方的优先级，数值越小优先级越高
+ * @details 连接紧张时高优先级等待者先得到归还的连接；配置reserve_interactive/reserve_normal后，
+ *          低优先级的借出总数不会挤占为更高优先级预留的连接
+ */
+enum class BorrowPriority
+{
+    Interactive = 0,    ///< 交互式请求(延迟敏感)
+    Normal = 1,         ///< 普通请求(默认)
+    Batch = 2           ///< 批处理/后台任务
+};
+
+/**
+ * @enum PoolError
+ * @brief 获取连接失败的原因，通过ConnectionPool::lastError()查询
+ */
+enum class PoolError
+{
+    None = 0,               ///< 最近一次获取成功
+    Timeout,                ///< 等待超时
+    Exhausted,              ///< 没有可用连接且调用方不等待(tryBorrow/tryGet)
+    BackendUnavailable,     ///< 断路器断开：后端不可用，没有空闲连接时立即失败
+    NotInitialized,         ///< 连接池配置非法，未启动
+    InvalidArgument,        ///< 参数非法(如批量获取的连接数超出范围)
+    Closed                  ///< 连接池正在关闭或已关闭(shutdown)
+};
+
+/**
+ * @brief 错误码的名称
+ */
+const char* poolErrorName(PoolError error);
+
+/**
+ * @struct PriorityStats
+ * @brief 某个优先级的借用与等待统计
+ */
+struct PriorityStats
+{
+    uint64_t borrows = 0;       // 借用请求数
+    uint64_t waits = 0;         // 进入等待队列的次数
+    uint64_t timeouts = 0;      // 等待超时次数
+    uint64_t rejected = 0;      // 断路器断开时被立即拒绝的次数
+    int64_t totalWaitUs = 0;    // 累计等待时间(微秒)
+    int64_t maxWaitUs = 0;      // 最长一次等待时间(微秒)
+    int reserved = 0;           // 为该优先级预留的连接数
+};
+
+/**
+ * @enum ResizeReason
+ * @brief 连接池扩容/缩容的原因
+ */
+enum class ResizeReason
+{
+    Waiters = 0,    ///< 扩容：等待者多于正在建立的连接
+    MinIdle,        ///< 扩容：空闲连接(含建立中的)低于min_idle
+    Target,         ///< 扩容：连接数低于目标大小(initial_size或自动计算的目标)
+    Replacement,    ///< 扩容：替换超过max_lifetime或因重新加载配置而退役的连接
+    Probe,          ///< 扩容：断路器半开时探测后端是否恢复
+    IdleTimeout,    ///< 缩容：连接空闲超过max_idle_time
+    Surplus,        ///< 缩容：连接数持续超出目标超过shrink_delay
+    Lifetime,       ///< 缩容：连接超过max_lifetime而退役
+    Reload          ///< 缩容：重新加载配置后，连接目标(地址/账号/库)已变更或连接数超出新的max_size
+};
+
+// 扩缩容原因的个数：新增原因时追加在Reload之后并同步更新此处
+constexpr int kResizeReasonCount = static_cast<int>(ResizeReason::Reload) + 1;
+
+/**
+ * @brief 扩缩容原因的名称
+ */
+const char* resizeReasonName(ResizeReason reason);
+
+/**
+ * @struct SizingStats
+ * @brief 连接池大小决策的统计
+ */
+struct SizingStats
+{
+    int target = 0;             // 当前目标大小
+    int minIdle = 0;            // 配置的最小空闲连接数
+    bool autoSize = false;      // 是否按Little定律自动计算目标
+    double arrivalRate = 0;     // 借用到达率(次/秒，平滑值)
+    double avgHoldMs = 0;       // 平均占用时长(毫秒，平滑值)
+    uint64_t resizes[kResizeReasonCount] = {};  // 按ResizeReason统计的扩缩容连接数
+    int lastReason = -1;        // 最近一次扩缩容的原因(ResizeReason，-1表示尚未发生)
+};
+
+class ConnectionGroup;
+class PooledConnection;
+class AcquireAwaitable;
 
 /**
  * @class ConnectionPool
  * @brief MySQL数据库连接池管理类
  * 
  * @details 该类实现了一个线程安全的MySQL连接池，用于管理和复用数据库连接。
- *          采用单例模式设计，确保整个应用程序中只有一个连接池实例。
+ *          每个实例拥有独立的配置、连接、锁和后台线程，同一进程可以为不同的
+ *          数据库(或冷热不同的负载)分别创建连接池；getConnectionPool()提供
+ *          按./mysql.cnf配置的默认实例。
  *          包含连接的生产、回收、超时管理等功能。
  */
 class ConnectionPool
 {
 public:
     /**
-     * @brief 获取连接池的单例实例
-     * @return ConnectionPool* 返回连接池单例对象的指针
+     * @brief 获取默认连接池实例(按./mysql.cnf配置)
+     * @return ConnectionPool* 返回默认连接池对象的指针
      * @note 线程安全的单例实现，使用局部静态变量保证线程安全(C++11及以上)
      */
     static ConnectionPool* getConnectionPool();
+
+    /**
+     * @brief 本线程最近一次获取连接的结果
+     * @details 获取接口返回空连接/空句柄时，用它区分超时、断路器断开等原因；
+     *          异步接口在执行回调的线程上设置，回调内调用即可
+     * @return PoolError 最近一次获取成功时为PoolError::None
+     */
+    static PoolError lastError();
+
+    /**
+     * @brief 按配置对象创建独立的连接池
+     * @param config 连接池配置
+     * @note 配置非法时输出错误日志，连接池不会启动，所有获取连接的调用都返回空
+     */
+    explicit ConnectionPool(const PoolConfig& config);
+
+    /**
+     * @brief 按配置文件创建独立的连接池
+     * @param configPath 配置文件路径，格式同mysql.cnf
+     */
+    explicit ConnectionPool(const string& configPath);
+
+    /**
+     * @brief 立即关闭连接池(不等待借出的连接)，见shutdown()
+     * @details 截止时间内未退出的后台线程在这里等待其结束，最长为一次connect_timeout
+     * @warning 析构前所有借出的连接都应已归还
+     */
+    ~ConnectionPool();
+
+    /**
+     * @brief 在截止时间内优雅关闭连接池
+     * @details 1. 停止接受借用：新的借用立即以PoolError::Closed失败，正在等待的借用方被唤醒并失败；
+     *             同时通知建连线程、维护线程和检查线程退出，不再发起新的握手
+     *          2. 并行关闭所有空闲、线程缓存、隔离和退役中的连接
+     *          3. 等待借出的连接归还、后台线程退出直到截止时间；关闭期间归还的连接由归还方直接关闭
+     * @param deadline 关闭的截止时间，超过后立即返回
+     * @return bool 截止时间前所有连接都已关闭且后台线程都已退出时返回true
+     * @note 可以重复调用；正在进行的握手不可中断，截止时间后才完成的连接由建连线程自己关闭
+     * @warning 返回false时仍有连接借出未还，连接池对象必须在它们归还之后才能析构
+     */
+    bool shutdown(chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief 在超时时间内优雅关闭连接池
+     * @param timeout 等待借出的连接归还的最长时间
+     */
+    bool shutdown(chrono::milliseconds timeout);
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * @brief 获取连接池大小决策的统计(目标大小、到达率、占用时长、各原因的扩缩容次数)
+     */
+    SizingStats getSizingStats() const;
+
+    /**
+     * @brief 获取断路器状态和统计
+     */
+    BreakerStats getBreakerStats() const;
+
+    /**
+     * @brief 当前生效的配置(快照的副本)
+     */
+    PoolConfig getConfig() const;
+
+    /**
+     * @brief 重新读取构造时使用的配置文件，并在不重启连接池的情况下应用
+     * @return bool 连接池不是由配置文件创建、文件读取失败或配置非法时返回false，保持当前配置
+     * @note 启用reload_on_sighup时，进程收到SIGHUP后由维护线程调用
+     */
+    bool reload();
+
+    /**
+     * @brief 在不重启连接池的情况下应用新配置
+     * @details 1. 新配置作为不可变快照整体发布，借用路径读取配置不加锁
+     *          2. max_size：调大后立即可以借出和建连；调小后多余的空闲连接立即关闭，
+     *             借出中的多余连接在归还时关闭；不能超过启动时的max_size(槽位容量)
+     *          3. 空闲回收、保活、存活时间等维护任务按新配置重新计时
+     *          4. 数据库地址、账号或库名变化时，新连接连到新目标，
+     *             已有连接在空闲时或归还时退役并补充
+     *          5. 分片、线程缓存、建连线程数、auto_size等结构性配置需要重启后生效，
+     *             重新加载时输出警告并保持原值
+     * @param config 新配置
+     * @return bool 配置非法或连接池未启动/正在关闭时返回false，保持当前配置
+     */
+    bool reload(const PoolConfig& config);
+
+    /**
+     * @brief 等待连接池就绪，可用于就绪探针
+     * @details 就绪指启动预热(建立initial_size个连接)已结束，且至少已有一个连接：
+     *          预热的建连全部失败(如MySQL不可用)时不算就绪，
+     *          之后建连线程建立第一个连接时才变为就绪
+     * @param timeout 最长等待时间
+     * @return bool 已就绪返回true；超时或连接池未启动返回false
+     * @note 同步启动时构造函数返回前预热已结束；异步启动(async_startup)时
+     *       连接池在第一个连接就绪后即可借出，预热在后台继续进行
+     */
+    bool waitUntilWarm(chrono::milliseconds timeout);
+
+    /**
+     * @brief 连接池是否已就绪(预热已结束且至少已有一个连接，见waitUntilWarm)
+     */
+    bool isWarm() const;
+
+    /**
+     * @brief 异步获取连接的完成回调，参数为空句柄表示超时
+     */
+    using AcquireCallback = function<void(PooledConnection)>;
     
     /**
      * @brief 从连接池获取一个可用连接
@@ -38,6 +255,129 @@ public:
      */
     shared_ptr<Connection> getConnection();
 
+    /**
+     * @brief 最多等待timeout获取一个可用连接
+     * @param timeout 最长等待时间
+     * @param prio 借用优先级
+     * @return shared_ptr<Connection> 超时返回nullptr
+     */
+    shared_ptr<Connection> getConnection(chrono::milliseconds timeout,
+                                         BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 在绝对截止时间之前获取一个可用连接
+     * @param deadline 截止时间(steady_clock)
+     * @param prio 借用优先级
+     * @return shared_ptr<Connection> 超过截止时间返回nullptr
+     * @note 连接紧张时，优先级高的等待者先得到归还的连接，同一优先级内截止时间早的优先
+     */
+    shared_ptr<Connection> getConnection(chrono::steady_clock::time_point deadline,
+                                         BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 尝试获取一个可用连接，从不等待
+     * @param prio 借用优先级
+     * @return shared_ptr<Connection> 当前没有空闲连接(或本优先级已达上限)时立即返回nullptr
+     */
+    shared_ptr<Connection> tryGetConnection(BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 借出一个连接，返回只能移动的RAII句柄(按连接池默认超时时间)
+     * @return PooledConnection 句柄析构时连接自动归还连接池；超时时句柄为空
+     * @note 与getConnection()相比，不分配shared_ptr控制块，也没有引用计数的原子操作，
+     *       适合借用后不需要共享连接的场景
+     */
+    PooledConnection borrowConnection();
+
+    /**
+     * @brief 最多等待timeout借出一个连接
+     * @param timeout 最长等待时间
+     * @param prio 借用优先级
+     * @return PooledConnection 超时时句柄为空
+     */
+    PooledConnection borrowConnection(chrono::milliseconds timeout,
+                                      BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 在绝对截止时间之前借出一个连接
+     * @param deadline 截止时间(steady_clock)
+     * @param prio 借用优先级
+     * @return PooledConnection 超过截止时间时句柄为空
+     */
+    PooledConnection borrowConnection(chrono::steady_clock::time_point deadline,
+                                      BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 尝试借出一个连接，从不等待
+     * @param prio 借用优先级
+     * @return PooledConnection 当前没有空闲连接时句柄为空
+     */
+    PooledConnection tryBorrowConnection(BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 异步获取连接(按连接池默认超时时间)，调用线程从不阻塞
+     * @param cb 完成回调，得到连接或超时时执行一次
+     * @note 有空闲连接时回调直接在调用线程执行(asyncGetConnection返回前)；
+     *       否则由归还/新建连接的线程在释放连接池锁后执行，超时回调由维护线程执行。
+     *       回调应尽快返回，不应在其中阻塞等待连接
+     */
+    void asyncGetConnection(AcquireCallback cb);
+
+    /**
+     * @brief 异步获取连接
+     * @param cb 完成回调
+     * @param timeout 最长等待时间
+     * @param prio 借用优先级
+     */
+    void asyncGetConnection(AcquireCallback cb, chrono::milliseconds timeout,
+                            BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 异步获取连接(按连接池默认超时时间)，通过future返回结果
+     * @return future<PooledConnection> 超时时值为空句柄
+     */
+    future<PooledConnection> asyncGetConnection();
+
+    /**
+     * @brief 异步获取连接，通过future返回结果
+     * @param timeout 最长等待时间
+     * @param prio 借用优先级
+     */
+    future<PooledConnection> asyncGetConnection(chrono::milliseconds timeout,
+                                                BorrowPriority prio = BorrowPriority::Normal);
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief 协程接口：PooledConnection conn = co_await pool->acquire();
+     * @return AcquireAwaitable 等待期间挂起协程而不占用线程，超时时结果为空句柄
+     * @note 协程可能在归还连接的线程上恢复执行
+     */
+    AcquireAwaitable acquire();
+
+    /**
+     * @brief 协程接口，指定超时时间和优先级
+     */
+    AcquireAwaitable acquire(chrono::milliseconds timeout,
+                             BorrowPriority prio = BorrowPriority::Normal);
+#endif
+
+    /**
+     * @brief 一次性获取k个连接(全有或全无)，用于扇出查询
+     * @param k 需要的连接数(1 ~ max_size)
+     * @param timeout 最长等待时间
+     * @param prio 借用优先级
+     * @return ConnectionGroup 成功时包含k个连接；超时或参数非法时为空
+     * @note 只加一次连接池锁完成预留；等待期间同一时刻只有一个批量请求累积连接，
+     *       不会因多个批量请求各持一部分连接而死锁
+     */
+    ConnectionGroup getConnections(int k, chrono::milliseconds timeout,
+                                   BorrowPriority prio = BorrowPriority::Normal);
+
+    /**
+     * @brief 获取某个优先级的借用与等待统计
+     */
+    PriorityStats getPriorityStats(BorrowPriority prio) const;
+
     /**
      * @brief 打印连接池的当前统计信息
      * @note 线程安全的方法，可以随时调用获取连接池状态
@@ -46,47 +386,730 @@ public:
     void printStats() const;
 
 private:
-    // 单例模式：禁止构造函数和析构函数公开访问
+    friend class ConnectionGroup;
+    friend class PooledConnection;
+    friend class AcquireAwaitable;
+
+    // 只初始化成员，由公开构造函数委托调用
     ConnectionPool();
-    ~ConnectionPool();
-    
+
+    /**
+     * @brief 校验并应用连接池配置
+     * @param config 连接池配置
+     * @return bool 配置合法返回true
+     */
+    bool applyConfig(const PoolConfig& config);
+
+    /**
+     * @brief 应用可以在线调整的配置：断路器、建连限速、各优先级借出上限、粗粒度时钟、SIGHUP处理
+     * @note 启动和重新加载配置时调用
+     */
+    void applyLiveSettings(const PoolConfig& config);
+
+    /**
+     * @brief 按reload_on_sighup安装或释放SIGHUP处理函数
+     * @note 最后一个释放的连接池恢复安装前的处理函数；关闭连接池时释放
+     */
+    void setReloadSignal(bool enabled);
+
+    /**
+     * @brief 创建分片和初始连接，启动建连、扫描、检查线程
+     * @note 连接工厂使用当前配置快照中的数据库地址和账号
+     */
+    void start();
+
+    /**
+     * @brief 为建连线程预占一个连接名额(连接工厂的reserve回调)
+     * @details 连接不足时预占名额后立即返回，由建连线程在锁外建立新连接；
+     *          达到上限后等待
+     * @return bool 连接池停止时返回false
+     */
+    bool reserveConnectionSlot();
+
+    /**
+     * @brief 判断是否需要建立新连接
+     * @param[out] reason 需要时的扩容原因
+     * @note 调用方必须持有_queueMutex
+     */
+    bool needMoreConnections(ResizeReason& reason) const;
+
+    /**
+     * @brief 建连线程是否可以建立新连接：断路器闭合时按需建连，
+     *        断开且冷却结束时由一个建连线程做半开探测
+     * @param[out] reason 可以建连时的扩容原因
+     * @note 调用方必须持有_queueMutex
+     */
+    bool canConnect(ResizeReason& reason);
+
+    /**
+     * @brief 下一次建连最早可以发起的时间：退避结束且令牌桶中有令牌
+     * @param now 当前时间
+     * @return chrono::steady_clock::time_point 可以立即建连时返回now
+     * @note 调用方必须持有_queueMutex
+     */
+    chrono::steady_clock::time_point connectAllowedAt(chrono::steady_clock::time_point now);
+
     /**
-     * @brief 从配置文件加载连接池配置
-     * @return bool 加载成功返回true，失败返回false
-     * @note 配置文件通常为JSON或INI格式，包含数据库连接参数和池大小等设置
+     * @brief 记录一次建连失败并按连续失败次数计算带抖动的指数退避
+     * @note 调用方必须持有_queueMutex
      */
-    bool loadConfigFile(); 
+    void backOffConnects();
 
     /**
-     * @brief 连接生产线程的主函数
-     * @details 独立线程中运行，根据需求动态创建新连接
-     *          当连接不足时创建新连接，达到上限后等待
+     * @brief 建连成功：清零连续失败次数并结束退避
      */
-    void produceConnectionTask();
+    void resetConnectBackoff();
 
     /**
-     * @brief 连接回收扫描线程的主函数
-     * @details 定期扫描空闲连接队列，回收超过最大空闲时间的连接
-     *          保持连接池在合理大小，避免资源浪费
+     * @brief 断路器断开：让所有等待者立即失败，并在冷却结束时唤醒建连线程探测
+     */
+    void onBreakerOpened();
+
+    /**
+     * @brief 当前生效的配置快照
+     * @note 快照发布后不再修改，并保留到连接池析构，读取方不需要加锁
+     */
+    const PoolConfig& currentConfig() const { return *_config.load(memory_order_acquire); }
+
+    /**
+     * @brief 按max_size重新计算各优先级的借出上限
+     */
+    void updatePriorityLimits(int maxSize);
+
+    /**
+     * @brief 重新加载配置后关闭超出新max_size的空闲连接(维护线程调用)
+     */
+    void trimToMaxSize();
+
+    /**
+     * @brief 连接目标变更后退役所有旧目标的空闲连接并补充(维护线程调用)
+     */
+    void retireStaleConnections();
+
+    /**
+     * @brief 唤醒所有同步/批量等待者，并以空句柄完成所有异步等待者
+     * @note 调用前须已使rejectingBorrows()为true，被唤醒的等待者据此失败
+     */
+    void abortWaiters();
+
+    /**
+     * @brief 预热已结束时标记连接池就绪并唤醒waitUntilWarm()的调用者
+     */
+    void markWarm();
+
+    /**
+     * @brief 关闭时取出所有未借出的连接(空闲、线程缓存、隔离、退役中)并并行关闭
+     * @return size_t 关闭的连接数
+     */
+    size_t closeIdleConnections();
+
+    /**
+     * @brief 在_joiner线程中回收预热、建连、维护和检查线程，完成后置_threadsJoined并通知_drainCv
+     */
+    void joinBackgroundThreads();
+
+    /**
+     * @brief 新连接建立成功：交给等待者或放入空闲队列
+     */
+    void connectionEstablished(Connection* p);
+
+    /**
+     * @brief 新连接建立失败：归还预占的名额并开始退避
+     */
+    void connectionFailed();
+
+    /**
+     * @brief 借出连接时的公共处理：刷新时间戳、记录借出时刻、检查最小空闲
+     */
+    void onBorrowed(Connection* p);
+
+    /**
+     * @brief 归还连接时记录其占用时长并减少借出计数(auto_size使用)
+     */
+    void recordHoldTime(Connection* p);
+
+    /**
+     * @brief 记录一次扩缩容
+     */
+    void recordResize(ResizeReason reason, uint64_t count = 1);
+
+    /**
+     * @brief 周期性计算目标大小，并在连接数持续超出目标时缩容(维护线程调用)
+     * @param now 当前时间
+     * @return bool 有连接被回收返回true
+     */
+    bool adjustPoolSize(chrono::steady_clock::time_point now);
+
+    /**
+     * @brief 登记维护任务，比维护线程当前的唤醒时间更早时唤醒它
+     */
+    void scheduleMaintenance(TimerQueue::Clock::time_point when, TimerQueue::Task task);
+
+    /**
+     * @brief 登记连接池的周期性维护任务(启动时及每次重新加载配置后调用)
+     */
+    void scheduleMaintenanceTasks();
+
+    /**
+     * @brief 回收空闲超时的连接
+     * @param now 当前时间
+     * @return 下一次可能有连接到期的时间
+     */
+    TimerQueue::Clock::time_point evictIdleConnections(TimerQueue::Clock::time_point now);
+
+    /**
+     * @brief 对超过keepalive_time未检测的空闲连接做保活检测
+     * @param now 当前时间
+     * @return 下一次有连接需要保活的时间
+     */
+    TimerQueue::Clock::time_point keepAliveIdleConnections(TimerQueue::Clock::time_point now);
+
+    /**
+     * @brief 退役超过max_lifetime的空闲连接并补充新连接
+     * @param now 当前时间
+     * @return 下一个空闲连接到期的时间
+     */
+    TimerQueue::Clock::time_point retireExpiredConnections(TimerQueue::Clock::time_point now);
+
+    /**
+     * @brief 不等待地预占一个连接名额(预热使用)
+     * @return bool 已达上限或连接池停止时返回false
+     */
+    bool tryReserveConnectionSlot();
+
+    /**
+     * @brief 启动预热：以有限并发建立initial_size个连接
+     */
+    void warmUp();
+
+    /**
+     * @brief 维护线程的主函数
+     * @details 睡到最早到期的维护任务或异步等待者截止时间，醒来后处理超时的异步等待者
+     *          并执行所有到期的维护任务(空闲回收、保活、线程缓存溢出、目标大小计算)
      */
     void scannerConnectionTask();
 
-    // 数据库连接配置参数
-    string _ip;                 // MySQL服务器IP地址
-    unsigned short _port;       // MySQL服务器端口号(默认3306)
-    string _username;           // 数据库用户名
-    string _password;           // 数据库密码
-    string _dbname;             // 默认连接的数据库名称
+    /**
+     * @brief 隔离连接检查线程的主函数
+     * @details 复查校验失败的可疑连接：恢复的重新投入使用，失效的关闭并通知生产者
+     *          所有网络I/O都在本线程中进行，不占用业务线程也不持有连接池锁
+     */
+    void checkerConnectionTask();
+
+    /**
+     * @brief 将校验失败的连接送入隔离区，由检查线程异步复查或关闭
+     * @param p 可疑连接
+     */
+    void quarantineConnection(Connection* p);
+
+    /**
+     * @brief 退役连接：交给检查线程关闭，并请求建连线程补充一个新连接
+     * @param p 超过存活时间或连接目标已变更的连接(不再投入使用)
+     * @param reason 退役原因(Lifetime或Reload)
+     */
+    void retireConnection(Connection* p, ResizeReason reason);
+
+    /**
+     * @brief 连接是否应当退役：超过max_lifetime，或建立时的连接目标已被重新加载的配置替换
+     */
+    bool shouldRetire(Connection* p, ResizeReason& reason) const;
+
+    /**
+     * @brief 借出前检查连接：应当退役的交给retireConnection，借出校验未通过的送入隔离区
+     * @return bool 连接可以借出返回true；返回false时已释放准入名额，连接不再属于调用方
+     */
+    bool checkBorrowedConnection(Connection* p, BorrowPriority prio);
+
+    /**
+     * @brief max_size调小后，归还时把超出新上限的连接交给检查线程关闭
+     * @return bool 连接不再属于调用方时返回true
+     */
+    bool shedExcessConnection(Connection* p);
+
+    /**
+     * @brief 借出连接的统一实现
+     * @param deadline 等待截止时间
+     * @param wait 为false时没有空闲连接立即返回，不进入等待队列
+     * @param prio 借用优先级
+     * @return Connection* 借出的连接，超时或失败返回nullptr
+     */
+    Connection* acquireConnection(chrono::steady_clock::time_point deadline, bool wait,
+                                  BorrowPriority prio);
+
+    /**
+     * @brief 快速路径：准入通过后无锁地从线程缓存或空闲队列取一个连接(不校验)
+     * @return Connection* 取不到时返回nullptr，且不占用准入名额
+     */
+    Connection* takeAvailableConnection(BorrowPriority prio);
+
+    /**
+     * @brief 把连接句柄转换为带自定义删除器的shared_ptr(getConnection系列的兼容实现)
+     * @param handle 借出的连接句柄(可为空)，转换后不再持有连接
+     */
+    shared_ptr<Connection> wrapConnection(PooledConnection&& handle);
+
+    /**
+     * @brief 归还连接(shared_ptr删除器调用)
+     * @param p 被归还的连接
+     * @param prio 借出时的优先级
+     * @details 按归还校验策略检查后，有效连接无锁放回空闲队列或交给等待者，
+     *          可疑连接送入隔离区；全程不在连接池锁内做网络I/O
+     */
+    void releaseConnection(Connection* p, BorrowPriority prio);
+
+    static constexpr int kPriorityCount = 3;
+
+    /**
+     * @struct PriorityCounters
+     * @brief 每个优先级的统计计数器(无锁累加)
+     */
+    struct PriorityCounters
+    {
+        atomic<uint64_t> borrows{0};
+        atomic<uint64_t> waits{0};
+        atomic<uint64_t> timeouts{0};
+        atomic<uint64_t> rejected{0};
+        atomic<int64_t> totalWaitUs{0};
+        atomic<int64_t> maxWaitUs{0};
+    };
+
+    /**
+     * @brief 记录一次因断路器断开或连接池关闭而被拒绝的借用，并设置本线程的lastError
+     */
+    void rejectBorrow(PriorityCounters& stats);
+
+    /**
+     * @brief 是否拒绝需要等待的借用(断路器断开或连接池正在关闭)
+     */
+    bool rejectingBorrows() const { return _closing.load(memory_order_relaxed) || !_breaker.allowRequests(); }
+
+    /**
+     * @brief 借出准入检查：确认本优先级借出后不会占用为更高优先级预留的连接
+     * @return bool 准入返回true(此时已占用名额，须由finishBorrow释放)
+     * @note 未配置预留时恒返回true，不做任何原子操作
+     */
+    bool admitBorrow(BorrowPriority prio);
+
+    /**
+     * @brief 释放admitBorrow占用的准入名额
+     */
+    void finishBorrow(BorrowPriority prio);
+
+    /**
+     * @brief 记录一次等待的耗时
+     */
+    static void recordWait(PriorityCounters& stats, chrono::steady_clock::time_point start);
+
+    /**
+     * @struct Shard
+     * @brief 连接池分片，每个分片拥有独立的空闲连接存储
+     * @note 按缓存行对齐，避免相邻分片的队列位置产生伪共享
+     */
+    struct alignas(64) Shard
+    {
+        Shard(size_t capacity, IdleOrder order) : idle(capacity, order) {}
+        IdleStore idle;   // 本分片的空闲连接
+    };
+
+    /**
+     * @brief 按校验策略检查连接是否可用
+     * @param p 待检查的连接
+     * @param policy 借出或归还对应的校验策略
+     * @return bool 可用返回true
+     */
+    bool validateConnection(Connection* p, ValidationPolicy policy) const;
+
+    /**
+     * @brief 获取当前线程的归属分片下标
+     * @note 线程首次访问时按轮转方式分配，之后固定不变
+     */
+    size_t homeShard() const;
+
+    /**
+     * @brief 无锁获取一个空闲连接
+     * @param[out] p 取出的连接
+     * @return bool 先尝试归属分片，为空时依次从其他分片窃取；全部为空返回false
+     */
+    bool popIdleConnection(Connection*& p);
+
+    /**
+     * @brief 所有分片的空闲连接总数(近似值)
+     */
+    size_t idleCount() const;
+
+    /**
+     * @brief 将空闲连接无锁放入指定分片(不唤醒等待者)
+     * @param p 空闲连接
+     * @param shard 目标分片下标
+     * @return bool 入队成功返回true；队列确实已满时销毁连接并返回false
+     */
+    bool enqueueIdleConnection(Connection* p, size_t shard);
+
+    /**
+     * @brief 归还/新建的空闲连接：有等待者时直接交给排在最前的等待者，
+     *        否则放回当前线程的归属分片
+     * @param p 空闲连接
+     */
+    void pushIdleConnection(Connection* p);
+
+    /**
+     * @struct Waiter
+     * @brief 等待连接的借用方
+     * @details 登记在_waiters中，归还方直接把连接写入conn并只唤醒该等待者
+     */
+    struct Waiter
+    {
+        Connection* conn = nullptr;   // 交接到手的连接
+        BorrowPriority prio = BorrowPriority::Normal;  // 借用优先级
+        condition_variable cv;        // 每个等待者独立的条件变量
+        chrono::steady_clock::time_point deadline;  // 等待截止时间
+        uint64_t seq = 0;             // 登记序号，截止时间相同时先登记者优先
+        size_t need = 1;              // 需要的连接数，大于1表示批量等待者
+        vector<Connection*> group;    // 批量等待者已累积的连接
+        AcquireCallback callback;     // 非空表示异步等待者(由连接池持有，完成后删除)
+        chrono::steady_clock::time_point since;  // 异步等待者的登记时间(用于统计等待时长)
+    };
+
+    /**
+     * @brief 等待队列排序：优先级高的在前，其次截止时间早的在前，相同时按登记顺序
+     */
+    struct WaiterOrder
+    {
+        bool operator()(const Waiter* a, const Waiter* b) const {
+            if (a->prio != b->prio) {
+                return a->prio < b->prio;
+            }
+            if (a->deadline != b->deadline) {
+                return a->deadline < b->deadline;
+            }
+            return a->seq < b->seq;
+        }
+    };
+
+    /**
+     * @brief 异步等待者按截止时间排序，供维护线程处理超时
+     */
+    struct AsyncDeadlineOrder
+    {
+        bool operator()(const Waiter* a, const Waiter* b) const {
+            if (a->deadline != b->deadline) {
+                return a->deadline < b->deadline;
+            }
+            return a->seq < b->seq;
+        }
+    };
+
+    /**
+     * @brief 登记异步等待者，连接池接管其所有权
+     */
+    void submitAsyncWaiter(Waiter* w);
 
-    // 连接池配置参数
-    int _initSize;              // 连接池初始连接数量
-    int _maxSize;              // 连接池允许的最大连接数量
-    int _maxIdleTime;          // 连接最大空闲时间(毫秒)
-    int _connectionTimeout;    // 获取连接的超时时间(毫秒)
+    /**
+     * @brief 在锁外执行已交接到连接的异步等待者的回调
+     * @note 所有可能在锁内交接连接的路径，解锁后都要调用一次
+     */
+    void runAsyncCompletions();
+
+    /**
+     * @brief 校验交接到的连接并执行异步等待者的回调，随后删除等待者
+     */
+    void completeAsyncWaiter(Waiter* w);
+
+    /**
+     * @brief 处理超过截止时间的异步等待者(维护线程调用)
+     */
+    void expireAsyncWaiters();
+
+    /**
+     * @brief 找到排在最前且准入通过的等待者
+     * @return 等待者迭代器，没有有资格的等待者时返回_waiters.end()
+     * @note 调用方必须持有_queueMutex；返回的等待者已占用准入名额
+     */
+    set<Waiter*, WaiterOrder>::iterator pickWaiterLocked();
+
+    /**
+     * @brief 把连接交给pickWaiterLocked选中的等待者，必要时唤醒它
+     * @note 调用方必须持有_queueMutex
+     */
+    void deliverLocked(set<Waiter*, WaiterOrder>::iterator it, Connection* p);
+
+    /**
+     * @brief 把连接交给排在最前且有资格的等待者并唤醒它
+     * @return bool 没有有资格的等待者时返回false，由调用方把连接放回空闲队列
+     * @note 调用方必须持有_queueMutex
+     */
+    bool handOffLocked(Connection* p);
+
+    /**
+     * @brief 空闲连接入队后检查是否有等待者，有则把空闲连接交给它们
+     */
+    void wakeWaiters();
+
+    /**
+     * @brief 按登记顺序把空闲连接交给等待者
+     * @note 调用方必须持有_queueMutex
+     */
+    void handOffIdleLocked();
+
+    /**
+     * @brief 销毁连接：回收其槽位并减少连接总数
+     * @param p 要销毁的连接(不在任何空闲队列中)
+     * @note 先回收槽位再减少计数，保证生产者按计数预占名额后一定能分配到槽位
+     */
+    void destroyConnection(Connection* p);
+
+    /**
+     * @brief 连接总数减少后通知生产者补充连接
+     */
+    void notifyProducer();
+
+    /**
+     * @struct ThreadCacheSlot
+     * @brief 线程本地连接缓存槽
+     * @details 每个使用连接池的线程拥有一个槽，保存该线程最近归还的连接。
+     *          所属线程和维护线程都只通过atomic exchange取走连接，因此无需加锁
+     */
+    struct ThreadCacheSlot
+    {
+        atomic<Connection*> conn{nullptr};   // 缓存的连接(nullptr表示空槽)
+        atomic<int64_t> stashedAt{0};        // 放入缓存的时间(PoolClock毫秒)
+        atomic<bool> abandoned{false};       // 所属线程已退出
+    };
+
+    /**
+     * @brief 获取当前线程在本连接池中的缓存槽
+     * @return ThreadCacheSlot* 首次调用时创建并登记到_cacheSlots
+     */
+    ThreadCacheSlot* localCacheSlot();
+
+    /**
+     * @brief 将线程缓存中的连接溢出回全局空闲队列
+     * @param force true时取走所有缓存连接，false时只取走闲置超过_threadCacheIdleTime的连接
+     * @return size_t 放回全局队列的连接数
+     * @note 只做无锁入队，不负责唤醒等待者，由调用方决定是否通知
+     */
+    size_t spillThreadCaches(bool force);
+
+    // 配置快照：可在线调整的配置(连接参数、上限、超时、校验、维护周期等)只从快照读取
+    atomic<const PoolConfig*> _config;              // 当前生效的配置
+    vector<unique_ptr<PoolConfig>> _configHistory;  // 发布过的所有快照，保留到析构(受_reloadMutex保护)
+    mutex _reloadMutex;                             // 串行化配置的应用
+    string _configPath;                             // 构造时使用的配置文件，reload()重新读取
+    atomic<uint64_t> _generation;                   // 连接目标(地址/账号/库)的版本，变化时旧连接退役
+    atomic<uint64_t> _maintenanceEpoch;             // 维护任务的纪元，重新登记时递增
+    int _reloadSignalsSeen;                         // 已处理的SIGHUP次数(维护线程私有)
+    bool _holdsSighup;                              // 是否持有进程级SIGHUP处理函数(受_reloadMutex保护)
+
+    // 结构性配置(启动时确定，重新加载时不变)
+    bool _threadCacheEnabled;  // 是否启用线程本地连接缓存
+    int _shardCount;           // 空闲连接分片数(0表示按CPU核数)
+    IdleOrder _idleOrder;      // 空闲连接复用顺序(FIFO/LIFO)
+    int _connectWorkers;       // 并发建连的工作线程数
+    int _warmupConcurrency;    // 启动预热时同时握手的连接数
+    bool _asyncStartup;        // 是否在后台预热(构造函数不等待)
+    bool _autoSize;            // 是否按Little定律自动计算目标大小
+    int _sizingInterval;       // 目标大小计算周期(毫秒)
+    int _priorityReserve[kPriorityCount];  // 各优先级预留的连接数(reserve_interactive/reserve_normal)
+    atomic_int _priorityLimit[kPriorityCount];  // 各优先级及更低优先级合计可借出的上限(随max_size重新计算)
+    bool _reservationEnabled;              // 是否配置了预留容量
 
     // 连接池状态管理
-    queue<Connection*> _connectionQue;  // 空闲连接队列(FIFO)
-    mutable mutex _queueMutex;         // 保护连接队列的互斥锁
+    unique_ptr<ConnectionSlab> _slab;   // 所有连接对象的槽位(容量为_maxSize)
+    unique_ptr<ConnectionFactory> _factory;  // 连接工厂(并发建连线程)
+    vector<unique_ptr<Shard>> _shards;  // 空闲连接分片(每个分片一个空闲连接存储，容量为2*_maxSize)
+    mutable mutex _queueMutex;         // 保护等待队列，并用于生产者的条件变量
     atomic_int _connectionCnt;         // 当前总连接数(包括在使用和空闲的)
-    condition_variable cv;             // 生产-消费模型的条件变量
+    atomic_int _waitingCnt;            // 等待队列长度(供无锁路径判断是否需要交接)
+    set<Waiter*, WaiterOrder> _waiters; // 等待连接的借用方(截止时间最早的先得到连接)
+    uint64_t _waiterSeq;               // 等待者登记序号(受_queueMutex保护)
+    Waiter* _groupAccumulator;         // 正在累积连接的批量等待者(同一时刻最多一个)
+    condition_variable _produceCv;     // 生产者专用条件变量
+
+    // 异步等待者(均受_queueMutex保护)
+    set<Waiter*, AsyncDeadlineOrder> _asyncWaiters;  // 尚未完成的异步等待者(截止时间最早的在前)
+    vector<Waiter*> _asyncReady;       // 已交接到连接、等待在锁外执行回调的异步等待者
+    atomic_int _asyncReadyCnt;         // _asyncReady长度(供解锁后无锁判断)
+    condition_variable _maintenanceCv; // 唤醒维护线程处理更早的维护任务或异步截止时间
+    chrono::steady_clock::time_point _maintenanceDue;  // 维护线程下次醒来的时间
+    TimerQueue _timers;                // 维护任务(由维护线程执行)
+
+    // 优先级准入与统计
+    atomic_int _borrowedAtOrBelow[kPriorityCount];    // 该优先级及更低优先级当前借出的连接数
+    PriorityCounters _priorityStats[kPriorityCount];  // 各优先级的借用与等待统计
+
+    // 隔离区：校验失败、等待后台复查或关闭的连接(仍计入_connectionCnt)
+    mutable mutex _quarantineMutex;
+    vector<Connection*> _quarantine;
+    vector<Connection*> _retiring;     // 超过max_lifetime、等待检查线程关闭的连接(仍计入_connectionCnt)
+    atomic_int _shedding;              // _retiring中超出max_size、不再补充的连接数(在_quarantineMutex下修改)
+    condition_variable _quarantineCv;
+
+    // 后台线程
+    atomic_bool _running;   // 后台线程运行标志，析构时置为false
+    thread _warmup;         // 异步启动时的预热线程
+    thread _scanner;        // 维护线程：执行_timers中的任务并处理异步等待者超时
+    thread _checker;        // 隔离连接检查线程
+
+    // 关闭
+    atomic_bool _closing;           // shutdown()已开始：拒绝新的借用，归还的连接直接关闭
+    mutex _shutdownMutex;           // 串行化shutdown()的调用
+    condition_variable _drainCv;    // 关闭期间有连接归还或后台线程全部退出时通知shutdown()(配合_queueMutex)
+    thread _joiner;                 // 关闭时回收后台线程，使shutdown()只等到截止时间
+    bool _threadsJoined;            // 后台线程已全部回收(受_queueMutex保护)
+
+    // 按需扩缩容
+    atomic_int _pendingConnects;                     // 已预占名额、正在建立的连接数
+    atomic_int _replacements;                        // 等待补充的退役连接数
+
+    atomic_int _targetSize;                          // 当前目标大小
+    atomic<uint64_t> _resizeCounts[kResizeReasonCount];  // 各原因的扩缩容连接数
+    atomic_int _lastResize;                          // 最近一次扩缩容原因
+    atomic<uint64_t> _holdNsTotal;                   // 本周期累计占用时长(纳秒)
+    atomic<uint64_t> _holdSamples;                   // 本周期归还次数
+    atomic<double> _arrivalRate;                     // 借用到达率(次/秒，平滑值)
+    atomic<double> _avgHoldMs;                       // 平均占用时长(毫秒，平滑值)
+    atomic_int _inUse;                               // 当前借出的连接数(仅auto_size时维护)
+    atomic_int _inUsePeak;                           // 本周期借出数的峰值(仅auto_size时维护)
+    uint64_t _lastBorrowTotal;                       // 上个周期末的累计借用次数(维护线程私有)
+    chrono::steady_clock::time_point _lastSizingAt;  // 上个周期的计算时间(维护线程私有)
+    chrono::steady_clock::time_point _surplusSince;  // 连接数开始超出目标的时间(维护线程私有)
+    int _surplusMin;                                 // 本次超出期间观察到的最小多余连接数(维护线程私有)
+
+    // 断路器
+    CircuitBreaker _breaker;
+
+    // 建连退避与限速(受_queueMutex保护)
+    TokenBucket _connectBucket;                      // 建连令牌桶(connect_rate/connect_burst)
+    int _connectFailStreak;                          // 连续建连失败次数，成功后清零
+    chrono::steady_clock::time_point _connectNotBefore;  // 退避结束前不发起新的建连
+
+    // 启动预热
+    mutable mutex _warmMutex;
+    condition_variable _warmCv;
+    bool _warmupDone;       // 启动预热是否已结束(受_warmMutex保护)
+    atomic<bool> _warm;     // 预热已结束且至少已有一个连接(在_warmMutex下置位)
+
+    // 线程本地缓存
+    uint64_t _poolId;                               // 连接池唯一编号(线程缓存按此区分连接池)
+    mutable mutex _cacheMutex;                      // 保护_cacheSlots的互斥锁
+    vector<shared_ptr<ThreadCacheSlot>> _cacheSlots; // 所有线程的缓存槽
+};
+
+/**
+ * @class ConnectionGroup
+ * @brief getConnections()批量借出的连接组
+ * @details 只能移动不能拷贝，析构(或reset)时把组内所有连接归还连接池
+ */
+class ConnectionGroup
+{
+public:
+    ConnectionGroup() : _pool(nullptr), _prio(BorrowPriority::Normal) {}
+    ConnectionGroup(ConnectionPool* pool, vector<Connection*> conns,
+                    BorrowPriority prio = BorrowPriority::Normal);
+    ConnectionGroup(ConnectionGroup&& other) noexcept;
+    ConnectionGroup& operator=(ConnectionGroup&& other) noexcept;
+    ConnectionGroup(const ConnectionGroup&) = delete;
+    ConnectionGroup& operator=(const ConnectionGroup&) = delete;
+    ~ConnectionGroup();
+
+    /**
+     * @brief 组内连接数，获取失败时为0
+     */
+    size_t size() const { return _conns.size(); }
+
+    bool empty() const { return _conns.empty(); }
+    explicit operator bool() const { return !_conns.empty(); }
+
+    /**
+     * @brief 访问第i个连接
+     */
+    Connection* operator[](size_t i) const { return _conns[i]; }
+
+    /**
+     * @brief 提前归还组内所有连接
+     */
+    void reset();
+
+private:
+    ConnectionPool* _pool;
+    vector<Connection*> _conns;
+    BorrowPriority _prio;   // 借出时的优先级
+};
+
+/**
+ * @class PooledConnection
+ * @brief 借出连接的RAII句柄
+ * @details 只能移动不能拷贝，析构(或reset)时把连接归还连接池。
+ *          句柄本身只有三个字段，不在堆上分配，也不维护引用计数
+ */
+class PooledConnection
+{
+public:
+    PooledConnection() : _pool(nullptr), _conn(nullptr), _prio(BorrowPriority::Normal) {}
+    PooledConnection(PooledConnection&& other) noexcept;
+    PooledConnection& operator=(PooledConnection&& other) noexcept;
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+    ~PooledConnection() { reset(); }
+
+    Connection* get() const { return _conn; }
+    Connection* operator->() const { return _conn; }
+    Connection& operator*() const { return *_conn; }
+    explicit operator bool() const { return _conn != nullptr; }
+
+    /**
+     * @brief 提前把连接归还连接池，之后句柄为空
+     */
+    void reset();
+
+private:
+    friend class ConnectionPool;
+    PooledConnection(ConnectionPool* pool, Connection* conn, BorrowPriority prio)
+        : _pool(pool), _conn(conn), _prio(prio) {}
+
+    /**
+     * @brief 放弃所有权但不归还连接，由调用方负责归还
+     */
+    Connection* release();
+
+    ConnectionPool* _pool;
+    Connection* _conn;
+    BorrowPriority _prio;   // 借出时的优先级
+};
+
+#if __cplusplus >= 202002L
+/**
+ * @class AcquireAwaitable
+ * @brief ConnectionPool::acquire()返回的等待体
+ * @details 有空闲连接时不挂起协程；否则登记为异步等待者并挂起，
+ *          得到连接或超时后在完成回调中恢复协程
+ */
+class AcquireAwaitable
+{
+public:
+    AcquireAwaitable(ConnectionPool* pool, chrono::milliseconds timeout, BorrowPriority prio)
+        : _pool(pool), _timeout(timeout), _prio(prio), _settled(false) {}
+
+    // 连接池未初始化或正在关闭时不挂起，直接以空句柄完成(lastError()为NotInitialized/Closed)
+    bool await_ready() {
+        _conn = _pool->tryBorrowConnection(_prio);
+        if (_conn) {
+            return true;
+        }
+        PoolError error = ConnectionPool::lastError();
+        return error == PoolError::NotInitialized || error == PoolError::Closed;
+    }
+
+    // 登记期间已交接到连接时返回false，由当前线程直接继续执行协程，不在回调中递归恢复
+    bool await_suspend(coroutine_handle<> h);
+
+    PooledConnection await_resume() { return move(_conn); }
+
+private:
+    ConnectionPool* _pool;
+    chrono::milliseconds _timeout;
+    BorrowPriority _prio;
+    PooledConnection _conn;     // 得到的连接(超时时为空)
+    atomic_bool _settled;       // await_suspend返回与回调执行中后发生的一方负责恢复协程
 };
+#endif
@@ -1,16 +1,22 @@
 #pragma once
 #include <mysql.h>
 #include <string>
-#include <ctime>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
 using namespace std;
+#include "PoolClock.h"
 
 /**
  * @class Connection
  * @brief MySQL数据库连接封装类
  * @details 封装MySQL C API，提供更安全的数据库连接和操作接口
  *          管理连接生命周期，自动维护连接状态和时间戳
+ * @note 按缓存行对齐，连接池中的连接由ConnectionSlab在连续槽位上构造，
+ *       相邻连接的状态字段不会落在同一缓存行
  */
-class Connection
+class alignas(64) Connection
 {
 public:
     /**
@@ -57,6 +63,14 @@ public:
      */
     bool isValid() const;
 
+    /**
+     * @brief 执行校验SQL检查连接是否可用
+     * @param sql 校验SQL(如 SELECT 1)
+     * @return bool 执行成功返回true
+     * @note 会读取并释放所有结果集，保证连接处于可复用状态
+     */
+    bool validate(const string& sql);
+
     /**
      * @brief 执行更新操作(INSERT/UPDATE/DELETE)
      * @param sql SQL语句
@@ -77,22 +91,126 @@ public:
      */
     MYSQL_RES* query(string sql);
 
+    /**
+     * @brief 获取SQL对应的预处理语句，优先从本连接的语句缓存中取
+     * @param sql 使用?占位符的SQL语句，缓存按SQL文本精确匹配
+     * @return MYSQL_STMT* 预处理语句，预处理失败返回nullptr
+     * @throw std::runtime_error 连接无效时抛出
+     * @note 语句归连接所有，随连接在借出/归还之间保留，调用者不得mysql_stmt_close；
+     *       缓存已满时关闭最久未使用的语句，之前取得的该语句指针随之失效
+     */
+    MYSQL_STMT* prepare(const string& sql);
+
+    /**
+     * @brief 以预处理语句方式执行SQL，服务端不必重复解析
+     * @param sql 使用?占位符的SQL语句
+     * @param params 参数绑定数组(个数与占位符一致)，没有参数时传nullptr
+     * @return MYSQL_STMT* 执行后的语句，可继续读取影响行数或绑定、读取结果集；失败返回nullptr
+     * @throw std::runtime_error 连接无效时抛出
+     * @note 语句句柄失效(如自动重连后服务端已释放该语句)时从缓存移除并关闭，下次调用重新预处理；
+     *       主键冲突、死锁等普通执行错误不影响缓存
+     * @code
+     * MYSQL_BIND bind[1] = {};
+     * bind[0].buffer_type = MYSQL_TYPE_LONG;
+     * bind[0].buffer = &id;
+     * MYSQL_STMT* stmt = conn.execute("UPDATE users SET status=1 WHERE id=?", bind);
+     * if (stmt) {
+     *     my_ulonglong rows = mysql_stmt_affected_rows(stmt);
+     * }
+     * @endcode
+     */
+    MYSQL_STMT* execute(const string& sql, MYSQL_BIND* params = nullptr);
+
+    /**
+     * @brief 设置语句缓存容量，当前缓存的语句超出新容量时关闭最久未使用的部分
+     */
+    void setStatementCacheSize(size_t capacity);
+
+    /**
+     * @brief 当前缓存的预处理语句数
+     */
+    size_t cachedStatements() const { return _stmtLru.size(); }
+
     /**
      * @brief 刷新连接空闲时间戳
-     * @note 将_alivetime设置为当前时钟时间
+     * @note 将_alivetime设置为当前时间(PoolClock，单调时钟)
      *       用于连接池管理连接存活时间
      */
-    void refreshAliveTime() { _alivetime = clock(); }
+    void refreshAliveTime() { _alivetime = _checkedAt = PoolClock::now(); }
 
     /**
      * @brief 获取连接空闲时长
-     * @return clock_t 毫秒级的空闲时间
+     * @return int64_t 毫秒级的空闲时间(墙上时间，与进程CPU占用无关)
+     */
+    int64_t getAliveeTime()const { return PoolClock::elapsedMs(_alivetime); }
+
+    /**
+     * @brief 记录借出时刻(连接池统计占用时长使用)
+     */
+    void markBorrowed() { _borrowedAt = PoolClock::now(); }
+
+    /**
+     * @brief 自上次markBorrowed()以来的占用时长
+     */
+    chrono::nanoseconds borrowedFor() const { return PoolClock::now() - _borrowedAt; }
+
+    /**
+     * @brief 记录一次保活检测(不影响空闲时长，空闲回收仍按最后使用时间计算)
+     */
+    void markChecked() { _checkedAt = PoolClock::now(); }
+
+    /**
+     * @brief 距上次使用或保活检测的时长
+     */
+    chrono::milliseconds checkedFor() const { return chrono::milliseconds(PoolClock::elapsedMs(_checkedAt)); }
+
+    /**
+     * @brief 设置连接的最长存活时间(从当前时刻算起)，到期后由连接池退役
+     */
+    void setLifetime(chrono::milliseconds lifetime) { _expiresAt = PoolClock::now() + lifetime; }
+
+    /**
+     * @brief 连接的退役时刻，未设置存活时间时为time_point::max()
+     */
+    PoolClock::time_point expiresAt() const { return _expiresAt; }
+
+    /**
+     * @brief 是否已超过最长存活时间
      */
-    clock_t getAliveeTime()const { return clock() - _alivetime; }
+    bool isExpired() const { return _expiresAt != PoolClock::time_point::max() && PoolClock::now() >= _expiresAt; }
+
+    /**
+     * @brief 记录建立连接时连接目标(地址/账号/库)的版本
+     */
+    void setGeneration(uint64_t generation) { _generation = generation; }
+
+    /**
+     * @brief 建立连接时连接目标的版本，与连接池当前版本不同时由连接池退役
+     */
+    uint64_t generation() const { return _generation; }
 
 private:
+    /**
+     * @brief 关闭最久未使用的语句，直到缓存不超过容量
+     */
+    void trimStatements(size_t capacity);
+
+    /**
+     * @brief 从缓存中移除并关闭一个语句
+     */
+    void evictStatement(const string& sql);
+
+    using StatementList = list<pair<string, MYSQL_STMT*>>;
+
     MYSQL *_conn;        ///< MySQL原生连接句柄
-    clock_t _alivetime;  ///< 记录最后活动时间戳(用于连接池超时管理)
+    PoolClock::time_point _alivetime;   ///< 记录最后活动时间戳(用于连接池超时管理)
+    PoolClock::time_point _borrowedAt;  ///< 最近一次借出的时刻
+    PoolClock::time_point _checkedAt;   ///< 最近一次使用或保活检测的时刻
+    PoolClock::time_point _expiresAt = PoolClock::time_point::max();  ///< 超过最长存活时间的时刻
+    uint64_t _generation = 0;           ///< 建立时连接目标的版本
+    StatementList _stmtLru;             ///< 缓存的预处理语句，最近使用的在前
+    unordered_map<string, StatementList::iterator> _stmtIndex;  ///< SQL文本到_stmtLru节点的索引
+    size_t _stmtCapacity = 64;          ///< 语句缓存容量
 };
 
 // 实现文件建议添加的注释示例：
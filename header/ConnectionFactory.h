@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+using namespace std;
+#include "Connection.h"
+#include "ConnectionSlab.h"
+#include "PoolConfig.h"
+
+/**
+ * @class ConnectionFactory
+ * @brief 连接工厂：负责在连接池锁之外建立新的数据库连接
+ *
+ * @details 持有若干个建连工作线程，每个线程循环执行：
+ *          1. reserve：向连接池预占一个连接名额(没有需求时在其中阻塞，返回false表示停止)
+ *          2. create：在槽位上构造Connection并完成TCP握手和认证，不持有任何连接池锁
+ *          3. 成功则publish交给连接池(直接交给等待者或放入空闲队列)，失败则cancel归还名额
+ *          多个工作线程并发握手，突发流量下新连接按完成顺序逐个投入使用，
+ *          不会让所有借用方排在一次串行握手之后
+ */
+class ConnectionFactory
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param slab 连接对象的槽位分配器(由连接池持有)
+     * @param config 连接池配置快照，使用其中的数据库地址、账号和存活时间
+     * @warning config必须在连接工厂析构之前一直有效
+     */
+    ConnectionFactory(ConnectionSlab& slab, const PoolConfig& config);
+
+    /**
+     * @brief 析构函数，等待所有工作线程退出
+     * @warning 析构前应已让reserve返回false，否则会一直阻塞
+     */
+    ~ConnectionFactory();
+
+    ConnectionFactory(const ConnectionFactory&) = delete;
+    ConnectionFactory& operator=(const ConnectionFactory&) = delete;
+
+    /**
+     * @brief 在调用线程上同步建立一个连接
+     * @return Connection* 成功返回已连接的连接，失败返回nullptr(槽位已回收)
+     * @note 配置了max_lifetime时为连接设置带随机提前量的存活时间(见lifetime())；
+     *       连接上记录建立时连接目标的版本
+     */
+    Connection* create();
+
+    /**
+     * @brief 切换到新的配置快照(重新加载配置时调用)，之后建立的连接使用新的地址和账号
+     * @param config 新的配置快照(必须在连接工厂析构之前一直有效)
+     * @param generation 连接目标的版本，记录在之后建立的连接上
+     */
+    void setConfig(const PoolConfig& config, uint64_t generation);
+
+    /**
+     * @brief 以有限并发批量建立连接(用于启动预热)，全部完成后返回
+     * @param count 要建立的连接数
+     * @param concurrency 同时进行握手的最大数量
+     * @param reserve 预占连接名额，返回false时不再继续建立
+     * @param publish 交付新建立的连接
+     * @param cancel 建连失败时归还预占的名额
+     * @return int 成功建立的连接数
+     */
+    int createMany(int count, int concurrency,
+                   const function<bool()>& reserve,
+                   const function<void(Connection*)>& publish,
+                   const function<void()>& cancel);
+
+    /**
+     * @brief 启动建连工作线程
+     * @param workers 工作线程数(至少为1)
+     * @param reserve 预占连接名额，阻塞直到需要新连接；返回false时工作线程退出
+     * @param publish 交付新建立的连接
+     * @param cancel 建连失败时归还预占的名额
+     */
+    void start(int workers,
+               function<bool()> reserve,
+               function<void(Connection*)> publish,
+               function<void()> cancel);
+
+    /**
+     * @brief 等待所有工作线程退出
+     */
+    void join();
+
+    /**
+     * @brief 工作线程数
+     */
+    int workerCount() const { return static_cast<int>(_workers.size()); }
+
+    /**
+     * @brief 正在握手中的连接数
+     */
+    int connecting() const { return _connecting.load(); }
+
+    /**
+     * @brief 累计建连失败次数
+     */
+    uint64_t failures() const { return _failures.load(); }
+
+private:
+    /**
+     * @brief 工作线程主函数
+     */
+    void workerTask();
+
+    /**
+     * @brief 为新连接抽取存活时间
+     * @details 在[max_lifetime × (1 - lifetime_jitter%), max_lifetime]内均匀分布：
+     *          同一时刻建立的连接(启动预热、故障切换后的重连)不会同时到期，
+     *          退役和重建分散开，不会形成重连风暴；也不会超过max_lifetime
+     */
+    static chrono::milliseconds lifetime(const PoolConfig& config);
+
+    ConnectionSlab& _slab;
+    atomic<const PoolConfig*> _config;  // 当前配置快照(地址、账号、存活时间)
+    atomic<uint64_t> _generation;       // 当前连接目标的版本
+
+    function<bool()> _reserve;
+    function<void(Connection*)> _publish;
+    function<void()> _cancel;
+    vector<thread> _workers;
+
+    atomic_int _connecting;         // 正在握手中的连接数
+    atomic<uint64_t> _failures;     // 累计建连失败次数
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+using namespace std;
+#include "Connection.h"
+#include "LockFreeRing.h"
+
+/**
+ * @class ConnectionSlab
+ * @brief Connection对象的定长槽位分配器
+ *
+ * @details 构造时一次性分配capacity个连续的、按缓存行对齐的槽位，之后只在槽位上
+ *          原地构造/析构Connection，不再向堆申请或归还内存：
+ *          - 所有连接集中在一块连续内存中，每个连接独占整数个缓存行，
+ *            不同核心上频繁更新的连接状态(如_alivetime)不会互相伪共享
+ *          - 空闲槽位保存在LockFreeRing中，分配/回收均无锁
+ *
+ * @note 连接池保证同时存在的连接数不超过max_size，槽位数按max_size分配即可
+ */
+class ConnectionSlab
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 槽位数量(同时存在的最大连接数)
+     */
+    explicit ConnectionSlab(size_t capacity);
+
+    /**
+     * @brief 析构函数
+     * @warning 只释放槽位内存，调用前应已通过deallocate销毁所有连接
+     */
+    ~ConnectionSlab() = default;
+
+    ConnectionSlab(const ConnectionSlab&) = delete;
+    ConnectionSlab& operator=(const ConnectionSlab&) = delete;
+
+    /**
+     * @brief 取一个空闲槽位并在其上构造Connection
+     * @return Connection* 新构造的连接(尚未建立数据库连接)
+     * @throw std::runtime_error 槽位已用尽，或Connection构造失败(此时槽位已归还)
+     */
+    Connection* allocate();
+
+    /**
+     * @brief 析构连接(关闭数据库连接)并回收其槽位
+     * @param p 由allocate返回的连接，nullptr时忽略
+     */
+    void deallocate(Connection* p);
+
+    /**
+     * @brief 槽位总数
+     */
+    size_t capacity() const { return _capacity; }
+
+    /**
+     * @brief 已占用的槽位数(近似值)
+     */
+    size_t inUse() const { return _capacity - _free.size(); }
+
+private:
+    /**
+     * @brief 把槽位放回空闲队列，入队暂时失败时重试直到成功
+     */
+    void release(Connection* slot);
+
+    /**
+     * @struct Slot
+     * @brief 恰好容纳一个Connection的未初始化存储
+     */
+    struct Slot
+    {
+        alignas(Connection) unsigned char bytes[sizeof(Connection)];
+    };
+
+    size_t _capacity;
+    unique_ptr<Slot[]> _slots;          // 连续的槽位存储
+    LockFreeRing<Connection*> _free;    // 空闲槽位
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+using namespace std;
+#include "Connection.h"
+#include "LockFreeRing.h"
+
+/**
+ * @enum IdleOrder
+ * @brief 空闲连接的复用顺序
+ */
+enum class IdleOrder
+{
+    FIFO,   ///< 先进先出：所有空闲连接轮流复用(无锁环形队列)
+    LIFO    ///< 后进先出：优先复用最近归还的连接，冷连接沉到底部等待回收
+};
+
+/**
+ * @class IdleStore
+ * @brief 单个分片的空闲连接存储
+ *
+ * @details 按配置的复用顺序选择底层结构：
+ *          - FIFO：LockFreeRing，入队/出队均无锁
+ *          - LIFO：栈(deque)，由分片私有的互斥锁保护，临界区只有一次指针读写
+ *          两种结构都区分"热端"(借出/归还)和"冷端"(最久未使用，供维护线程回收)
+ */
+class IdleStore
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 最大容量
+     * @param order 复用顺序
+     */
+    IdleStore(size_t capacity, IdleOrder order);
+
+    IdleStore(const IdleStore&) = delete;
+    IdleStore& operator=(const IdleStore&) = delete;
+
+    /**
+     * @brief 归还空闲连接(放入热端)
+     * @return bool 成功返回true，存储已满返回false
+     */
+    bool push(Connection* p);
+
+    /**
+     * @brief 借出空闲连接
+     * @param[out] p 取出的连接：FIFO取最早归还的，LIFO取最近归还的
+     * @return bool 成功返回true，存储为空返回false
+     */
+    bool pop(Connection*& p);
+
+    /**
+     * @brief 把连接放回冷端(保活检测后归还，不打乱LIFO的冷热顺序)
+     * @return bool 成功返回true，存储已满返回false
+     * @note FIFO环形队列只能从队尾入队，与push相同
+     */
+    bool pushCold(Connection* p);
+
+    /**
+     * @brief 从冷端回收空闲超时的连接
+     * @param expired 判断连接是否空闲超时
+     * @param maxCount 本次最多回收的连接数
+     * @param[out] out 被移出存储的连接，由调用方负责销毁
+     * @return size_t 回收的连接数
+     *
+     * @note FIFO：环形队列无法窥视队头，按快照长度弹出-检查-放回轮转一遍；
+     *       LIFO：从栈底(冷端)向栈顶检查整个栈，其余连接保持原有顺序。
+     *       两种顺序下每个连接都会被检查(直到达到maxCount)，expired可借此统计未超时连接
+     */
+    size_t evictCold(const function<bool(Connection*)>& expired, size_t maxCount,
+                     vector<Connection*>& out);
+
+    /**
+     * @brief 当前空闲连接数(近似值)
+     */
+    size_t size() const;
+
+    /**
+     * @brief 复用顺序
+     */
+    IdleOrder order() const { return _order; }
+
+private:
+    IdleOrder _order;
+    size_t _capacity;
+    unique_ptr<LockFreeRing<Connection*>> _ring;  // FIFO模式使用
+    mutable mutex _stackMutex;                    // LIFO模式保护_stack
+    deque<Connection*> _stack;                    // LIFO模式使用，front为冷端，back为热端
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+using namespace std;
+
+/**
+ * @class LockFreeRing
+ * @brief 有界无锁多生产者多消费者(MPMC)环形队列
+ *
+ * @details 基于Dmitry Vyukov的有界MPMC队列算法实现：
+ *          - 每个槽位带一个序号(sequence)，生产者/消费者通过CAS推进入队/出队位置
+ *          - 容量在构造时确定(向上取整为2的幂)，运行期间不再分配内存
+ *          - push/pop均不使用互斥锁，队列满/空时立即返回false
+ *
+ * @note 入队和出队位置分别独占一个缓存行，避免生产者与消费者之间的伪共享
+ * @warning T应为廉价可拷贝类型(如指针)
+ */
+template <typename T>
+class LockFreeRing
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 期望容量，实际容量向上取整为2的幂(最小为2)
+     */
+    explicit LockFreeRing(size_t capacity)
+    {
+        size_t cap = 2;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        _mask = cap - 1;
+        _cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; ++i) {
+            _cells[i].sequence.store(i, memory_order_relaxed);
+        }
+        _enqueuePos.store(0, memory_order_relaxed);
+        _dequeuePos.store(0, memory_order_relaxed);
+    }
+
+    LockFreeRing(const LockFreeRing&) = delete;
+    LockFreeRing& operator=(const LockFreeRing&) = delete;
+
+    /**
+     * @brief 入队
+     * @param value 要放入的元素
+     * @return bool 成功返回true，队列已满返回false
+     */
+    bool push(T value)
+    {
+        Cell* cell;
+        size_t pos = _enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列已满
+            } else {
+                pos = _enqueuePos.load(memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 出队(取最早入队的元素)
+     * @param[out] value 取出的元素
+     * @return bool 成功返回true，队列为空返回false
+     */
+    bool pop(T& value)
+    {
+        Cell* cell;
+        size_t pos = _dequeuePos.load(memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列为空
+            } else {
+                pos = _dequeuePos.load(memory_order_relaxed);
+            }
+        }
+        value = cell->value;
+        cell->sequence.store(pos + _mask + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 获取当前元素个数
+     * @return size_t 近似值，并发修改时仅供统计和启发式判断使用
+     */
+    size_t size() const
+    {
+        size_t enq = _enqueuePos.load(memory_order_acquire);
+        size_t deq = _dequeuePos.load(memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    /**
+     * @brief 队列是否为空(近似值)
+     */
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief 获取队列容量
+     */
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    struct Cell
+    {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    static constexpr size_t kCacheLine = 64;
+
+    unique_ptr<Cell[]> _cells;
+    size_t _mask;
+    alignas(kCacheLine) atomic<size_t> _enqueuePos;
+    alignas(kCacheLine) atomic<size_t> _dequeuePos;
+    char _pad[kCacheLine - sizeof(atomic<size_t>)];
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+using namespace std;
+
+/**
+ * @class PoolClock
+ * @brief 连接时间戳使用的单调时钟
+ *
+ * @details 满足标准库Clock要求，可直接与chrono::duration运算：
+ *          - 默认模式：基于steady_clock(Linux上为vDSO读取CLOCK_MONOTONIC，不陷入内核)
+ *          - 粗粒度模式：Linux上读取CLOCK_MONOTONIC_COARSE，只读一次内核维护的
+ *            时间戳，不读硬件计数器，开销约为默认模式的几分之一；
+ *            精度为一个时钟节拍(通常1~4毫秒)，对空闲/存活时长这类毫秒级判断足够
+ *          两种模式与steady_clock同一起点，运行中切换不会产生时间跳变
+ *
+ * @note 粗粒度模式是进程级设置，任一连接池开启后对所有连接池生效；
+ *       没有CLOCK_MONOTONIC_COARSE的平台上忽略该设置
+ * @warning 不要用于计算等待截止时间：条件变量的wait_until仍使用steady_clock
+ */
+class PoolClock
+{
+public:
+    using duration = chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = chrono::time_point<PoolClock, duration>;
+    static constexpr bool is_steady = true;
+
+    /**
+     * @brief 当前时间
+     */
+    static time_point now() noexcept
+    {
+#ifdef CLOCK_MONOTONIC_COARSE
+        if (s_coarse.load(memory_order_relaxed)) {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return time_point(duration(int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec));
+        }
+#endif
+        return time_point(chrono::duration_cast<duration>(
+            chrono::steady_clock::now().time_since_epoch()));
+    }
+
+    /**
+     * @brief 开启或关闭粗粒度模式
+     */
+    static void setCoarse(bool coarse) { s_coarse.store(coarse, memory_order_relaxed); }
+
+    /**
+     * @brief 是否处于粗粒度模式
+     */
+    static bool coarse() { return s_coarse.load(memory_order_relaxed); }
+
+    /**
+     * @brief 自某时刻以来经过的毫秒数
+     */
+    static int64_t elapsedMs(time_point since)
+    {
+        return chrono::duration_cast<chrono::milliseconds>(now() - since).count();
+    }
+
+private:
+    static inline atomic<bool> s_coarse{false};
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+using namespace std;
+#include "IdleStore.h"
+
+/**
+ * @enum ValidationPolicy
+ * @brief 借出/归还连接时的有效性校验策略
+ */
+enum class ValidationPolicy
+{
+    Never,      ///< 不校验
+    IdleTime,   ///< 仅当连接空闲超过validation_idle_time时校验
+    Ping,       ///< 每次mysql_ping
+    Query       ///< 每次执行validation_query
+};
+
+/**
+ * @brief 校验策略的配置名(never/idle/ping/query)
+ */
+const char* validationPolicyName(ValidationPolicy policy);
+
+/**
+ * @struct PoolConfig
+ * @brief 单个连接池实例的全部配置
+ *
+ * @details 可以直接在代码中填写后传给ConnectionPool的构造函数，
+ *          也可以用load()从`key=value`格式的配置文件(如mysql.cnf)读取。
+ *          同一进程中的多个连接池各自持有一份配置，互不影响
+ */
+struct PoolConfig
+{
+    // 数据库连接参数
+    string ip;                          // MySQL服务器IP地址(ip/host)
+    unsigned short port = 3306;         // MySQL服务器端口号
+    string username;                    // 数据库用户名(username/user)
+    string password;                    // 数据库密码
+    string dbname;                      // 默认连接的数据库名称(dbname/database)
+
+    // 连接池参数
+    int initSize = 5;                   // 初始连接数量(initial_size)
+    int maxSize = 50;                   // 最大连接数量(max_size)
+    int maxIdleTime = 600;              // 连接最大空闲时间(秒，max_idle_time)
+    int connectionTimeout = 1000;       // 获取连接的超时时间(毫秒，connect_timeout)
+    bool threadCacheEnabled = false;    // 是否启用线程本地连接缓存(thread_cache)
+    int threadCacheIdleTime = 1000;     // 线程缓存中连接的最长闲置时间(毫秒)
+    int shardCount = 1;                 // 空闲连接分片数(0表示按CPU核数)
+    IdleOrder idleOrder = IdleOrder::FIFO;  // 空闲连接复用顺序(idle_order)
+    ValidationPolicy borrowValidation = ValidationPolicy::Ping;  // 借出校验策略(test_on_borrow)
+    ValidationPolicy returnValidation = ValidationPolicy::Ping;  // 归还校验策略(test_on_return)
+    string validationQuery;             // 校验SQL(validation_query)
+    int validationIdleTime = 5000;      // IdleTime策略下触发校验的空闲时长(毫秒)
+    int reserveInteractive = 0;         // 为交互式借用预留的连接数(reserve_interactive)
+    int reserveNormal = 0;              // 为普通及以上借用预留的连接数(reserve_normal)
+    int connectWorkers = 2;             // 并发建连的工作线程数(connect_workers)
+    int warmupConcurrency = 8;          // 启动预热时同时握手的连接数(warmup_concurrency)
+    bool asyncStartup = false;          // 异步启动：构造函数不等待预热完成(async_startup)
+    int minIdle = 0;                    // 空闲连接(含建立中的)低于该值时补充(min_idle)
+    bool autoSize = false;              // 按到达率×占用时长(Little定律)自动设定目标大小(auto_size)
+    int shrinkDelay = 30000;            // 连接数持续超出目标多久后才缩容(毫秒，shrink_delay)
+    int sizingInterval = 1000;          // 目标大小的计算周期(毫秒，sizing_interval)
+    int maxLifetime = 0;                // 连接最长存活时间(毫秒，0表示不限制，max_lifetime)
+    int lifetimeJitter = 10;            // 存活时间随机提前的最大比例(百分比，lifetime_jitter)
+    int breakerFailures = 5;            // 连续建连失败多少次后断路器断开(0关闭断路器，breaker_failures)
+    int breakerOpenTime = 5000;         // 断路器断开后多久做半开探测(毫秒，breaker_open_time)
+    int connectBackoffBase = 100;       // 建连失败后的初始退避时间，连续失败时逐次翻倍(毫秒，connect_backoff_base)
+    int connectBackoffMax = 10000;      // 建连失败退避时间上限(毫秒，connect_backoff_max)
+    double connectRate = 0;             // 每秒最多发起的建连数(0表示不限速，connect_rate)
+    int connectBurst = 10;              // 建连令牌桶容量：空闲后允许连续发起的建连数(connect_burst)
+    bool reloadOnSighup = false;        // 收到SIGHUP时重新读取配置文件(reload_on_sighup)
+    int stmtCacheSize = 64;             // 每个连接缓存的预处理语句数(LRU，stmt_cache_size)
+    bool coarseClock = false;           // 连接时间戳使用粗粒度单调时钟(进程级，coarse_clock)
+    int keepaliveTime = 0;              // 空闲连接超过该时长未检测即做保活检测(毫秒，0关闭，keepalive_time)
+
+    /**
+     * @brief 从配置文件读取配置，未出现的配置项保持当前值
+     * @param path 配置文件路径
+     * @return bool 文件不存在、有语法错误或取值非法时返回false
+     * @note 配置文件格式为`key=value`, 支持#注释和[section]
+     */
+    bool load(const string& path);
+
+    /**
+     * @brief 检查配置是否完整、取值是否合法
+     * @return bool 合法返回true，不合法时逐项输出错误日志
+     */
+    bool validate() const;
+};
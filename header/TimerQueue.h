@@ -0,0 +1,82 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+using namespace std;
+
+/**
+ * @class TimerQueue
+ * @brief 按截止时间排序的定时任务队列(最小堆)
+ *
+ * @details 连接池的所有周期性维护工作(空闲回收、保活、线程缓存溢出、目标大小计算等)
+ *          都登记为定时任务，由同一个维护线程驱动：
+ *          - 维护线程只需睡到nextDeadline()，醒来后调用runDue()执行所有到期任务
+ *          - 任务返回下次执行时间，据此重新入堆；返回time_point::max()表示不再执行
+ *          - 入堆/出堆O(log n)，任务数量很少，开销可以忽略
+ *
+ * @note 任务在不持有队列锁的情况下执行，任务内部可以再调用schedule()
+ */
+class TimerQueue
+{
+public:
+    using Clock = chrono::steady_clock;
+
+    /**
+     * @brief 定时任务
+     * @param now 本次执行时的当前时间
+     * @return Clock::time_point 下次执行时间，Clock::time_point::max()表示不再执行
+     */
+    using Task = function<Clock::time_point(Clock::time_point now)>;
+
+    TimerQueue() = default;
+    TimerQueue(const TimerQueue&) = delete;
+    TimerQueue& operator=(const TimerQueue&) = delete;
+
+    /**
+     * @brief 登记定时任务
+     * @param when 执行时间
+     * @param task 任务
+     * @return bool 该任务成为最早到期的任务时返回true(调用方应唤醒维护线程)
+     */
+    bool schedule(Clock::time_point when, Task task);
+
+    /**
+     * @brief 执行所有已到期的任务，并按返回值重新登记
+     * @param now 当前时间
+     * @note 抛出异常的任务记录日志后不再登记
+     * @return size_t 执行的任务数
+     */
+    size_t runDue(Clock::time_point now);
+
+    /**
+     * @brief 最早到期任务的执行时间，队列为空时返回Clock::time_point::max()
+     */
+    Clock::time_point nextDeadline() const;
+
+    /**
+     * @brief 丢弃所有任务
+     */
+    void clear();
+
+private:
+    struct Entry
+    {
+        Clock::time_point when;
+        uint64_t seq;   // 登记顺序，截止时间相同的任务按登记顺序执行
+        Task task;
+    };
+
+    // 堆顶为最早到期的任务
+    struct Later
+    {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.when != b.when ? a.when > b.when : a.seq > b.seq;
+        }
+    };
+
+    mutable mutex _mutex;
+    vector<Entry> _heap;
+    uint64_t _seq = 0;
+};
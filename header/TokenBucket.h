@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+using namespace std;
+
+/**
+ * @class TokenBucket
+ * @brief 令牌桶限速器
+ *
+ * @details 以rate个/秒的速度补充令牌，最多积累burst个：
+ *          - 空闲一段时间后允许一次性消耗burst个令牌(例如启动预热)
+ *          - 持续请求时长期速率不超过rate，用于平滑后端重启后的重连风暴
+ *          - rate为0表示不限速，所有调用立即成功
+ *
+ * @note 不是线程安全的：连接池只在持有_queueMutex时调用
+ */
+class TokenBucket
+{
+public:
+    using Clock = chrono::steady_clock;
+
+    /**
+     * @brief 设置参数
+     * @param rate 每秒补充的令牌数，0表示不限速
+     * @param burst 最多积累的令牌数
+     * @note 第一次设置时令牌桶为满；之后重新设置(如重新加载配置)保留当前令牌数，
+     *       只截断到新的burst，避免重新设置绕过限速
+     */
+    void configure(double rate, int burst);
+
+    /**
+     * @brief 是否不限速
+     */
+    bool unlimited() const { return _rate <= 0; }
+
+    /**
+     * @brief 下一个令牌可用的时间，已有令牌时返回now
+     */
+    Clock::time_point availableAt(Clock::time_point now);
+
+    /**
+     * @brief 取走一个令牌
+     * @return bool 没有可用令牌时返回false
+     */
+    bool tryTake(Clock::time_point now);
+
+    /**
+     * @brief 当前令牌数(用于统计)
+     */
+    double tokens(Clock::time_point now) const;
+
+private:
+    void refill(Clock::time_point now);
+
+    double _rate = 0;
+    double _burst = 0;
+    double _tokens = 0;
+    Clock::time_point _last;
+    bool _configured = false;   // 是否已设置过参数
+};
@@ -0,0 +1,78 @@
+#include "CircuitBreaker.h"
+
+const char* breakerStateName(BreakerState state) {
+    switch (state) {
+    case BreakerState::Closed: return "closed";
+    case BreakerState::Open: return "open";
+    case BreakerState::HalfOpen: return "half-open";
+    }
+    return "unknown";
+}
+
+void CircuitBreaker::configure(int failureThreshold, chrono::milliseconds openTime) {
+    lock_guard<mutex> lock(_mutex);
+    _threshold = failureThreshold;
+    _openTime = openTime;
+}
+
+bool CircuitBreaker::tryBeginProbe() {
+    lock_guard<mutex> lock(_mutex);
+    if (state() != BreakerState::Open || chrono::steady_clock::now() < _retryAt) {
+        return false;
+    }
+    _state = static_cast<int>(BreakerState::HalfOpen);
+    return true;
+}
+
+chrono::steady_clock::time_point CircuitBreaker::retryAt() const {
+    lock_guard<mutex> lock(_mutex);
+    return _retryAt;
+}
+
+bool CircuitBreaker::onSuccess() {
+    _failures.store(0, memory_order_relaxed);
+    if (allowRequests()) {
+        return false;
+    }
+    lock_guard<mutex> lock(_mutex);
+    if (state() == BreakerState::Closed) {
+        return false;
+    }
+    _state = static_cast<int>(BreakerState::Closed);
+    return true;
+}
+
+bool CircuitBreaker::onFailure() {
+    int failures = _failures.fetch_add(1, memory_order_relaxed) + 1;
+    lock_guard<mutex> lock(_mutex);
+    if (_threshold <= 0) {
+        return false;
+    }
+    switch (state()) {
+    case BreakerState::Closed:
+        if (failures < _threshold) {
+            return false;
+        }
+        break;
+    case BreakerState::HalfOpen:
+        break;
+    case BreakerState::Open:
+        return false;   // 断开前发起的握手较晚失败，不影响冷却计时
+    }
+    openLocked();
+    return true;
+}
+
+void CircuitBreaker::openLocked() {
+    _state = static_cast<int>(BreakerState::Open);
+    _retryAt = chrono::steady_clock::now() + _openTime;
+    _opens.fetch_add(1, memory_order_relaxed);
+}
+
+BreakerStats CircuitBreaker::stats() const {
+    BreakerStats stats;
+    stats.state = state();
+    stats.consecutiveFailures = _failures.load(memory_order_relaxed);
+    stats.opens = _opens.load(memory_order_relaxed);
+    return stats;
+}
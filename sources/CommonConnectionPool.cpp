@@ -1,6 +1,100 @@
 #include "CommonConnectionPool.h"
 #include "public.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <csignal>
 #define DEBUG
+
+namespace {
+// 连接池编号分配器，线程缓存按编号区分不同连接池实例
+atomic<uint64_t> s_nextPoolId(1);
+
+// 线程序号分配器，线程按序号轮转分配归属分片
+atomic<size_t> s_nextThreadIndex(0);
+
+// 线程缓存时间戳在每次归还时记录，使用PoolClock(可开启粗粒度模式)
+int64_t steadyNowMs() {
+    return chrono::duration_cast<chrono::milliseconds>(
+        PoolClock::now().time_since_epoch()).count();
+}
+
+// 自动目标大小在Little定律估算值之上留出的余量，吸收到达率的短时波动
+constexpr double kAutoSizeHeadroom = 1.25;
+
+// 到达率/占用时长的指数平滑系数(新样本权重)
+constexpr double kSizingSmoothing = 0.3;
+
+// 保活检测每批从分片中取出的连接数：检测期间连接不能借出，分批取出避免分片长时间显得为空
+constexpr size_t kKeepaliveBatch = 4;
+
+// 有借用方在等待时推迟保活检测的时长
+constexpr chrono::milliseconds kKeepaliveRetryDelay(100);
+
+// 本线程最近一次获取连接的结果
+thread_local PoolError t_lastError = PoolError::None;
+
+// 进程收到SIGHUP的次数：信号处理函数只做一次无锁原子递增(异步信号安全)，
+// 启用reload_on_sighup的连接池由维护线程定期检查计数变化后重新加载
+atomic<int> s_reloadSignals(0);
+void onReloadSignal(int) {
+    s_reloadSignals.fetch_add(1, memory_order_relaxed);
+}
+
+// SIGHUP处理函数是进程级的：第一个启用reload_on_sighup的连接池安装，
+// 最后一个关闭该选项(或关闭连接池)时恢复安装前的处理函数
+mutex s_sighupMutex;
+int s_sighupUsers = 0;                  // 持有SIGHUP处理函数的连接池数(受s_sighupMutex保护)
+void (*s_prevSighup)(int) = SIG_DFL;    // 安装前的处理函数
+
+void holdReloadSignal() {
+    lock_guard<mutex> lock(s_sighupMutex);
+    if (s_sighupUsers++ == 0) {
+        auto prev = signal(SIGHUP, onReloadSignal);
+        s_prevSighup = prev == SIG_ERR ? SIG_DFL : prev;
+    }
+}
+
+void releaseReloadSignal() {
+    lock_guard<mutex> lock(s_sighupMutex);
+    if (--s_sighupUsers == 0) {
+        signal(SIGHUP, s_prevSighup);
+    }
+}
+
+// 维护线程检查SIGHUP计数的周期
+constexpr chrono::milliseconds kReloadPollInterval(500);
+}
+
+// 错误码的名称
+const char* poolErrorName(PoolError error) {
+    switch (error) {
+    case PoolError::None: return "none";
+    case PoolError::Timeout: return "timeout";
+    case PoolError::Exhausted: return "exhausted";
+    case PoolError::BackendUnavailable: return "backend unavailable";
+    case PoolError::NotInitialized: return "not initialized";
+    case PoolError::InvalidArgument: return "invalid argument";
+    case PoolError::Closed: return "closed";
+    }
+    return "unknown";
+}
+
+// 扩缩容原因的名称
+const char* resizeReasonName(ResizeReason reason) {
+    switch (reason) {
+    case ResizeReason::Waiters: return "waiters";
+    case ResizeReason::MinIdle: return "min_idle";
+    case ResizeReason::Target: return "target";
+    case ResizeReason::Replacement: return "replacement";
+    case ResizeReason::Probe: return "probe";
+    case ResizeReason::IdleTimeout: return "idle_timeout";
+    case ResizeReason::Surplus: return "surplus";
+    case ResizeReason::Lifetime: return "lifetime";
+    case ResizeReason::Reload: return "reload";
+    }
+    return "unknown";
+}
 /**
  * @brief 获取连接池单例实例（线程安全的懒汉模式)
  * @return ConnectionPool* 返回连接池单例对象的指针
@@ -11,351 +105,2452 @@
  */
 ConnectionPool* ConnectionPool::getConnectionPool()
 {
-	static ConnectionPool pool; // lock和unlock
+	static ConnectionPool pool("mysql.cnf"); // lock和unlock
 	return &pool;
 }
 
+// 本线程最近一次获取连接的结果
+PoolError ConnectionPool::lastError() {
+    return t_lastError;
+}
+
 /**
- * @brief 从配置文件加载连接池配置
- * @return bool 加载成功返回true，失败返回false
- * @note 配置文件格式为`key=value`, 支持#注释和[section]
- *       支持的配置项有：ip, port, username, password, dbname, initsize, maxsize, maxidletime
- *       连接池的初始大小、最大大小、最大空闲时间等 
+ * @brief 校验并应用连接池配置
+ * @param config 连接池配置
+ * @return bool 配置合法返回true，非法时输出错误日志并返回false(连接池不会启动)
+ * @note 结构性配置复制到成员中，其余配置作为第一个快照发布；
+ *       同时计算各优先级的借出上限，并把shard_count为0解析为CPU核数
  */
-bool ConnectionPool::loadConfigFile() {
-    FILE *pf = fopen("mysql.cnf", "r");
-    if (pf == nullptr) {
-        LOG("mysql.cnf file is not exist!");
+bool ConnectionPool::applyConfig(const PoolConfig& config) {
+    if (!config.validate()) {
         return false;
     }
 
-    char line[1024];
-    int lineNum = 0;
-    bool hasError = false;
+    _threadCacheEnabled = config.threadCacheEnabled;
+    _shardCount = config.shardCount;
+    _idleOrder = config.idleOrder;
+    _priorityReserve[0] = config.reserveInteractive;
+    _priorityReserve[1] = config.reserveNormal;
+    _priorityReserve[2] = 0;
+    _connectWorkers = config.connectWorkers;
+    _warmupConcurrency = config.warmupConcurrency;
+    _asyncStartup = config.asyncStartup;
+    _autoSize = config.autoSize;
+    _sizingInterval = config.sizingInterval;
+    _reservationEnabled = config.reserveInteractive + config.reserveNormal > 0;
 
-    while (fgets(line, sizeof(line), pf)) {
-        lineNum++;
-        string str = line;
-
-        // 去除行尾换行符和回车符
-        str.erase(str.find_last_not_of("\r\n") + 1);
-
-        // 去除行首空白
-        str.erase(0, str.find_first_not_of(" \t"));
+    {
+        lock_guard<mutex> guard(_reloadMutex);
+        _configHistory.emplace_back(new PoolConfig(config));
+        _config = _configHistory.back().get();
+    }
+    applyLiveSettings(config);
+    _targetSize = config.initSize;
 
-        // 跳过空行和注释行
-        if (str.empty() || str[0] == '#') {
-            continue;
-        }
+    // 分片数为0表示按CPU核数分片
+    if (_shardCount <= 0) {
+        _shardCount = max(1u, thread::hardware_concurrency());
+    }
 
-        // 跳过段落标识符（例如 [client], [pool]）
-        if (str.front() == '[' && str.back() == ']') {
-            continue;
-        }
+    LOG("Configuration loaded successfully:");
+    LOG("  MySQL Server: " << config.ip << ":" << config.port);
+    LOG("  Username: " << config.username);
+    LOG("  Database: " << config.dbname);
+    LOG("  Pool init size: " << config.initSize);
+    LOG("  Pool max size: " << config.maxSize);
+    LOG("  Max idle time: " << config.maxIdleTime << "s");
+    LOG("  Connection timeout: " << config.connectionTimeout << "s");
+    LOG("  Borrow validation: " << validationPolicyName(config.borrowValidation));
+    LOG("  Return validation: " << validationPolicyName(config.returnValidation));
+    if (!config.validationQuery.empty()) {
+        LOG("  Validation query: " << config.validationQuery);
+    }
+    LOG("  Validation idle time: " << config.validationIdleTime << "ms");
+    LOG("  Reserved (interactive/normal): " << _priorityReserve[0] << "/" << _priorityReserve[1]);
+    LOG("  Connect workers: " << _connectWorkers);
+    LOG("  Warm-up: " << _warmupConcurrency << " concurrent, "
+        << (_asyncStartup ? "async" : "sync") << " startup");
+    LOG("  Sizing: min idle " << config.minIdle << ", auto size " << (_autoSize ? "on" : "off")
+        << ", shrink delay " << config.shrinkDelay << "ms, interval " << _sizingInterval << "ms");
+    LOG("  Clock: " << (PoolClock::coarse() ? "coarse" : "steady"));
+    LOG("  Keepalive: " << (config.keepaliveTime > 0 ? to_string(config.keepaliveTime) + "ms" : string("off")));
+    LOG("  Max lifetime: " << (config.maxLifetime > 0 ? to_string(config.maxLifetime) + "ms" : string("unlimited"))
+        << ", jitter " << config.lifetimeJitter << "%");
+    if (config.breakerFailures > 0) {
+        LOG("  Circuit breaker: open after " << config.breakerFailures << " failures, retry after "
+            << config.breakerOpenTime << "ms");
+    } else {
+        LOG("  Circuit breaker: off");
+    }
+    LOG("  Shard count: " << _shardCount);
+    LOG("  Idle order: " << (_idleOrder == IdleOrder::LIFO ? "lifo" : "fifo"));
+    LOG("  Thread cache: " << (_threadCacheEnabled ? "on" : "off")
+        << " (idle " << config.threadCacheIdleTime << "ms)");
+    LOG("  Reload on SIGHUP: " << (config.reloadOnSighup ? "on" : "off"));
 
-        // 查找并去除行内注释
-        size_t commentPos = str.find('#');
-        if (commentPos != string::npos) {
-            str = str.substr(0, commentPos);
-            str.erase(str.find_last_not_of(" \t") + 1);
-        }
+    return true;
+}
 
-        if (str.empty()) {
-            continue;
-        }
+// 应用不需要重建连接池结构的配置：断路器、建连限速、借出上限等(启动和重新加载时调用)
+void ConnectionPool::applyLiveSettings(const PoolConfig& config) {
+    _breaker.configure(config.breakerFailures, chrono::milliseconds(config.breakerOpenTime));
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        _connectBucket.configure(config.connectRate, config.connectBurst);
+    }
+    updatePriorityLimits(config.maxSize);
 
-        // 解析键值对
-        size_t eq_pos = str.find('=');
-        if (eq_pos == string::npos) {
-            LOG("Config syntax error at line " << lineNum << ": missing '='");
-            hasError = true;
-            continue;
-        }
+    // 粗粒度时钟是进程级设置：任一连接池开启即对所有连接池生效
+    if (config.coarseClock) {
+        PoolClock::setCoarse(true);
+    }
+    setReloadSignal(config.reloadOnSighup);
+}
 
-        string key = str.substr(0, eq_pos);
-        string value = str.substr(eq_pos + 1);
+// 按reload_on_sighup安装或释放SIGHUP处理函数(构造期间或持有_reloadMutex时调用)
+void ConnectionPool::setReloadSignal(bool enabled) {
+    if (enabled == _holdsSighup) {
+        return;
+    }
+    if (enabled) {
+        holdReloadSignal();
+    } else {
+        releaseReloadSignal();
+    }
+    _holdsSighup = enabled;
+}
 
-        // 去除键和值的首尾空白
-        key.erase(0, key.find_first_not_of(" \t"));
-        key.erase(key.find_last_not_of(" \t") + 1);
-        value.erase(0, value.find_first_not_of(" \t"));
-        value.erase(value.find_last_not_of(" \t") + 1);
+// 计算各优先级的借出上限：max_size减去所有更高优先级的预留数
+void ConnectionPool::updatePriorityLimits(int maxSize) {
+    int reservedAbove = 0;
+    for (int i = 0; i < kPriorityCount; ++i) {
+        _priorityLimit[i] = maxSize - reservedAbove;
+        reservedAbove += _priorityReserve[i];
+    }
+}
 
-        // 字段名统一转为小写
-        transform(key.begin(), key.end(), key.begin(), ::tolower);
+PoolConfig ConnectionPool::getConfig() const {
+    return currentConfig();
+}
 
-        // 处理配置项
-        if (key == "ip" || key == "host") _ip = value;
-        else if (key == "port") _port = stoi(value);
-        else if (key == "username" || key == "user") _username = value;
-        else if (key == "password") _password = value;
-        else if (key == "dbname" || key == "database") _dbname = value;
-        else if (key == "initsize" || key == "initial_size") _initSize = stoi(value);
-        else if (key == "maxsize" || key == "max_size") _maxSize = stoi(value);
-        else if (key == "maxidletime" || key == "max_idle_time") _maxIdleTime = stoi(value);
-        else if (key == "connectiontimeout" || key == "connect_timeout") _connectionTimeout = stoi(value);
-        else if (key == "test_on_borrow" || key == "validation_query") {
-            // 忽略不影响主逻辑的配置项
-        }
-        else {
-            LOG("Warning: Unknown config key '" << key << "' at line " << lineNum);
-        }
+bool ConnectionPool::reload() {
+    if (_configPath.empty()) {
+        LOG("连接池不是由配置文件创建，无法重新加载配置");
+        return false;
+    }
+    PoolConfig config;
+    if (!config.load(_configPath)) {
+        LOG("重新读取配置文件失败，保持当前配置: " << _configPath);
+        return false;
     }
+    return reload(config);
+}
 
-    fclose(pf);
+/**
+ * @brief 在线应用新配置
+ * @details 1. 结构性配置(分片、线程缓存、建连线程、预热、auto_size等)保持原值并输出警告；
+ *             max_size不能超过启动时的槽位容量；调整后的组合再校验一次，非法时整体拒绝
+ *          2. 在_reloadMutex下发布新快照：旧快照保留到析构，正在读取旧快照的线程不受影响
+ *          3. 数据库地址、账号或库名变化时递增连接目标代数，先于新快照交给连接工厂，
+ *             此后建立的连接带有新代数；旧代数的连接在空闲时由维护线程、
+ *             借出中的在归还时退役并补充
+ *          4. 调整目标大小并唤醒建连线程和等待者，使调大的max_size立即生效
+ *          5. 在维护线程上按新配置重新登记维护任务，并关闭超出新max_size的空闲连接
+ *
+ * @note 借用路径只读取快照指针，不与本函数竞争任何锁
+ */
+bool ConnectionPool::reload(const PoolConfig& config) {
+    if (_shards.empty() || _closing.load()) {
+        LOG("连接池未启动或正在关闭，忽略重新加载");
+        return false;
+    }
+    if (!config.validate()) {
+        LOG("新配置非法，保持当前配置");
+        return false;
+    }
 
-    // 验证必要配置
-    if (_ip.empty()) {
-        LOG("Error: Missing required configuration 'ip' or 'host'");
-        hasError = true;
+    lock_guard<mutex> guard(_reloadMutex);
+    if (_closing.load()) {  // 与shutdown()释放SIGHUP处理函数互斥
+        return false;
     }
-    if (_username.empty()) {
-        LOG("Error: Missing required configuration 'username' or 'user'");
-        hasError = true;
+    const PoolConfig& old = currentConfig();
+    PoolConfig cfg(config);
+
+    // 结构性配置需要重启后生效
+    auto pin = [](auto& field, const auto& current, const char* key) {
+        if (field != current) {
+            LOG("配置项" << key << "需要重启连接池后生效，本次保持原值");
+            field = current;
+        }
+    };
+    pin(cfg.shardCount, old.shardCount, "shard_count");
+    pin(cfg.idleOrder, old.idleOrder, "idle_order");
+    pin(cfg.threadCacheEnabled, old.threadCacheEnabled, "thread_cache");
+    pin(cfg.connectWorkers, old.connectWorkers, "connect_workers");
+    pin(cfg.warmupConcurrency, old.warmupConcurrency, "warmup_concurrency");
+    pin(cfg.asyncStartup, old.asyncStartup, "async_startup");
+    pin(cfg.autoSize, old.autoSize, "auto_size");
+    pin(cfg.sizingInterval, old.sizingInterval, "sizing_interval");
+    pin(cfg.reserveInteractive, old.reserveInteractive, "reserve_interactive");
+    pin(cfg.reserveNormal, old.reserveNormal, "reserve_normal");
+    pin(cfg.coarseClock, old.coarseClock, "coarse_clock");
+    pin(cfg.stmtCacheSize, old.stmtCacheSize, "stmt_cache_size");
+    if (cfg.maxSize > (int)_slab->capacity()) {
+        LOG("max_size超过启动时的容量" << _slab->capacity() << "，按容量生效");
+        cfg.maxSize = (int)_slab->capacity();
+        cfg.initSize = min(cfg.initSize, cfg.maxSize);
     }
-    if (_dbname.empty()) {
-        LOG("Error: Missing required configuration 'dbname' or 'database'");
-        hasError = true;
+    // 保持原值和按容量截断后的组合可能不再合法(如预留容量或min_idle超过截断后的max_size)
+    if (!cfg.validate()) {
+        LOG("新配置与需要重启才生效的原值组合后非法，保持当前配置");
+        return false;
     }
 
-    // 验证数值范围
-    if (_initSize <= 0 || _maxSize <= 0 || _initSize > _maxSize) {
-        LOG("Error: Invalid pool size configuration");
-        hasError = true;
+    bool retarget = cfg.ip != old.ip || cfg.port != old.port || cfg.username != old.username
+        || cfg.password != old.password || cfg.dbname != old.dbname;
+
+    _configHistory.emplace_back(new PoolConfig(cfg));
+    const PoolConfig& snapshot = *_configHistory.back();
+    _config.store(&snapshot, memory_order_release);
+    if (retarget) {
+        ++_generation;
     }
+    _factory->setConfig(snapshot, _generation.load());
+    applyLiveSettings(snapshot);
 
-    if (hasError) {
-        return false;
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        if (!_autoSize) {
+            _targetSize = cfg.initSize;
+        } else {
+            _targetSize = min(max(_targetSize.load(), cfg.initSize), cfg.maxSize);
+        }
+        _produceCv.notify_all();
     }
+    wakeWaiters();
 
-    LOG("Configuration loaded successfully:");
-    LOG("  MySQL Server: " << _ip << ":" << _port);
-    LOG("  Username: " << _username);
-    LOG("  Database: " << _dbname);
-    LOG("  Pool init size: " << _initSize);
-    LOG("  Pool max size: " << _maxSize);
-    LOG("  Max idle time: " << _maxIdleTime << "s");
-    LOG("  Connection timeout: " << _connectionTimeout << "s");
+    // 维护任务按新配置重新计时，超出上限和旧目标的空闲连接在维护线程上关闭
+    scheduleMaintenance(TimerQueue::Clock::now(), [this, retarget](TimerQueue::Clock::time_point) {
+        scheduleMaintenanceTasks();
+        trimToMaxSize();
+        if (retarget) {
+            retireStaleConnections();
+        }
+        return TimerQueue::Clock::time_point::max();
+    });
 
+    LOG("配置已重新加载: " << cfg.ip << ":" << cfg.port << "/" << cfg.dbname
+        << ", init " << cfg.initSize << ", max " << cfg.maxSize
+        << ", idle " << cfg.maxIdleTime << "s" << (retarget ? ", 连接目标已变更" : ""));
     return true;
 }
 
 /**
  * @brief 连接池的构造函数
- * @details 1. 该构造函数为支持单例模式声明为私有成员
- *          2. 该函数在第一次调用`getConnectionPool()`时被调用
- *          3. 该函数在调用时，调用`loadConfigFile()`，并检查配置文件是否被正确读取
- *             3.1 当未被正确读取，直接返回则会导致连接池中连接空置，连接池未被正确启动
- *             3.2 当被正确读取，参考 （4.）  
- *          4. 函数创建初始数量的连接，并将连接放入连接池中
- *          5. 启动一个新的线程`produceConnectionTask`，作为连接的生产者
- *             5.1 该线程会在连接池中连接不足时，自动创建新的连接
- *          6. 启动一个新的线程`scannerConnectionTask`，作为连接的回收者
- *             6.1 该线程会定时扫描连接池中空闲连接，回收超过最大空闲时间的连接
+ * @details 1. 私有默认构造函数只初始化成员，由两个公开构造函数委托调用
+ *          2. 单例在第一次调用`getConnectionPool()`时以"mysql.cnf"构造
+ *          3. 调用`applyConfig()`检查并应用配置
+ *             3.1 配置非法时直接返回，连接池中没有连接，也不会启动后台线程
+ *             3.2 配置合法时调用`start()`，参考 （4.）  
+ *          4. 创建_shardCount个分片(每个分片一个FIFO或LIFO空闲连接存储)，
+ *             创建初始数量的连接并轮流放入各分片
+ *          5. 启动连接工厂的connect_workers个建连线程，作为连接的生产者
+ *             5.1 有等待者、空闲连接低于min_idle或连接数低于目标大小时，
+ *                 各建连线程并发地在锁外建立新连接(见needMoreConnections)
+ *          6. 启动维护线程`scannerConnectionTask`，作为连接的回收者
+ *             6.1 该线程按定时任务的到期时间回收空闲超时的连接、做保活检测等
+ *          7. 启动一个新的线程`checkerConnectionTask`，复查或关闭校验失败的隔离连接
  */
 ConnectionPool::ConnectionPool()
+    : _config(nullptr)
+    , _generation(0)
+    , _maintenanceEpoch(0)
+    , _reloadSignalsSeen(0)
+    , _holdsSighup(false)
+    , _threadCacheEnabled(false)
+    , _shardCount(1)
+    , _idleOrder(IdleOrder::FIFO)
+    , _connectWorkers(2)
+    , _warmupConcurrency(8)
+    , _asyncStartup(false)
+    , _autoSize(false)
+    , _sizingInterval(1000)
+    , _priorityReserve{0, 0, 0}
+    , _priorityLimit{{0}, {0}, {0}}
+    , _reservationEnabled(false)
+    , _connectionCnt(0)
+    , _waitingCnt(0)
+    , _waiterSeq(0)
+    , _groupAccumulator(nullptr)
+    , _asyncReadyCnt(0)
+    , _maintenanceDue(chrono::steady_clock::time_point::max())
+    , _borrowedAtOrBelow{{0}, {0}, {0}}
+    , _shedding(0)
+    , _running(false)
+    , _closing(false)
+    , _threadsJoined(false)
+    , _pendingConnects(0)
+    , _replacements(0)
+    , _targetSize(0)
+    , _resizeCounts{{0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}}
+    , _lastResize(-1)
+    , _holdNsTotal(0)
+    , _holdSamples(0)
+    , _arrivalRate(0)
+    , _avgHoldMs(0)
+    , _inUse(0)
+    , _inUsePeak(0)
+    , _lastBorrowTotal(0)
+    , _surplusMin(0)
+    , _connectFailStreak(0)
+    , _warmupDone(false)
+    , _warm(false)
+    , _poolId(s_nextPoolId++)
+{
+    // 配置非法、连接池未启动时也保证currentConfig()可用
+    _configHistory.emplace_back(new PoolConfig);
+    _config = _configHistory.back().get();
+}
+
+// 按配置对象创建连接池
+ConnectionPool::ConnectionPool(const PoolConfig& config)
+    : ConnectionPool()
+{
+	if (applyConfig(config))
+	{
+		start();
+	}
+}
+
+// 等待启动预热完成
+bool ConnectionPool::waitUntilWarm(chrono::milliseconds timeout) {
+    if (_shards.empty()) {
+        return false;
+    }
+    unique_lock<mutex> lock(_warmMutex);
+    return _warmCv.wait_for(lock, timeout, [this] { return _warm.load(); });
+}
+
+// 连接池是否已就绪
+bool ConnectionPool::isWarm() const {
+    return _warm.load();
+}
+
+// 只有预热结束后才标记就绪：异步预热期间建立的连接不会提前报告就绪
+void ConnectionPool::markWarm() {
+    lock_guard<mutex> lock(_warmMutex);
+    if (_warmupDone && !_warm) {
+        _warm = true;
+        _warmCv.notify_all();
+    }
+}
+
+/**
+ * @brief 启动预热：以warmup_concurrency的并发度建立_initSize个连接
+ * @details 同步启动时在构造函数中执行，连接轮流放入各分片；
+ *          异步启动时在后台线程执行，每个连接建立后立即交给等待者或放入空闲队列。
+ *          结束时已有连接则唤醒waitUntilWarm()的调用者；全部建连失败时不报告就绪，
+ *          由connectionEstablished()在之后建立第一个连接时报告
+ */
+void ConnectionPool::warmUp() {
+    atomic<size_t> next(0);
+    int created = _factory->createMany(currentConfig().initSize, _warmupConcurrency,
+        [this] { return tryReserveConnectionSlot(); },
+        [this, &next](Connection* p) {
+            if (_asyncStartup) {
+                connectionEstablished(p);
+            } else {
+                enqueueIdleConnection(p, next++ % _shards.size());
+                _pendingConnects--;
+                _breaker.onSuccess();
+                resetConnectBackoff();
+            }
+        },
+        [this] { connectionFailed(); });
+    LOG("连接池预热完成: " << created << "/" << currentConfig().initSize);
+
+    {
+        lock_guard<mutex> lock(_warmMutex);
+        _warmupDone = true;
+    }
+    // 预热期间建连线程也可能已建立连接
+    if (created > 0 || _connectionCnt - _pendingConnects > 0) {
+        markWarm();
+    } else {
+        LOG("预热未建立任何连接，建立第一个连接后才报告就绪");
+    }
+}
+
+// 按配置文件创建连接池
+ConnectionPool::ConnectionPool(const string& configPath)
+    : ConnectionPool()
 {
-	// 加载配置项了
-	if (!loadConfigFile())
+	PoolConfig config;
+	_configPath = configPath;
+	if (config.load(configPath) && applyConfig(config))
+	{
+		start();
+	}
+}
+
+// 创建分片和初始连接，启动后台线程
+void ConnectionPool::start() {
+	// 所有连接对象都在连续的缓存行对齐槽位上构造，销毁后槽位复用
+	const PoolConfig& config = currentConfig();
+	_slab.reset(new ConnectionSlab(config.maxSize));
+	_factory.reset(new ConnectionFactory(*_slab, config));
+
+	// 每个分片的空闲连接存储容量为最大连接数的两倍，运行期间不会再扩容：
+	// 所有连接都可能归还到同一分片；留出余量是为了避免"出队进行中的槽位"
+	// 被入队方短暂误判为队列已满
+	for (int i = 0; i < _shardCount; ++i)
 	{
-		return;
+		_shards.emplace_back(new Shard(config.maxSize * 2, _idleOrder));
 	}
 
-	// 创建初始数量的连接
-	for (int i = 0; i < _initSize; ++i)
+	_running = true;
+
+	// 预热：以有限并发建立初始数量的连接(失败的由建连线程随后补齐)。
+	// 异步启动时在后台预热，构造函数立即返回，第一个连接就绪后即可借出
+	if (_asyncStartup)
+	{
+		_warmup = thread(std::bind(&ConnectionPool::warmUp, this));
+	}
+	else
 	{
-		Connection *p = new Connection();
-		p->connect(_ip, _port, _username, _password, _dbname);
-		p->refreshAliveTime(); // 刷新一下开始空闲的起始时间
-		_connectionQue.push(p);
-		_connectionCnt++;
+		warmUp();
 	}
 
-	// 启动一个新的线程，作为连接的生产者 linux thread => pthread_create
-	thread produce(std::bind(&ConnectionPool::produceConnectionTask, this));
-	produce.detach();
+	// 启动建连线程，作为连接的生产者：按需预占名额后在锁外并发握手，完成一个交付一个
+	_factory->start(_connectWorkers,
+		[this] { return reserveConnectionSlot(); },
+		[this](Connection* p) { connectionEstablished(p); },
+		[this] { connectionFailed(); });
+
+	// 启动维护线程，按各自的到期时间执行空闲回收、保活等维护任务
+	_reloadSignalsSeen = s_reloadSignals.load();
+	scheduleMaintenanceTasks();
+	_scanner = thread(std::bind(&ConnectionPool::scannerConnectionTask, this));
 
-	// 启动一个新的定时线程，扫描超过maxIdleTime时间的空闲连接，进行对于的连接回收
-	thread scanner(std::bind(&ConnectionPool::scannerConnectionTask, this));
-	scanner.detach();
+	// 启动隔离连接检查线程，在锁外复查或关闭可疑连接
+	_checker = thread(std::bind(&ConnectionPool::checkerConnectionTask, this));
 }
 
 
-// 给外部提供接口，从连接池中获取一个可用的空闲连接
+// 给外部提供接口，按连接池默认超时时间获取连接
 shared_ptr<Connection> ConnectionPool::getConnection() {
-    unique_lock<mutex> lock(_queueMutex);
-    while (_connectionQue.empty()) {
-        if (cv_status::timeout == cv.wait_for(lock, chrono::milliseconds(_connectionTimeout))) {
-            LOG("获取连接超时");
-            return nullptr;
-        }
-    }
-
-    // 检查连接有效性
-    while (!_connectionQue.empty()) {
-        auto pcon = _connectionQue.front();
-        _connectionQue.pop();
-        if (pcon->isValid()) {  // 假设Connection类已实现isValid()
-            pcon->refreshAliveTime();
-            return shared_ptr<Connection>(pcon, [this](Connection* p) {
-                unique_lock<mutex> lock(_queueMutex);
-                if (p->isValid()) {  // 只有有效连接才放回队列
-                    p->refreshAliveTime();
-                    _connectionQue.push(p);
-                } else {
-                    _connectionCnt--;
-                    delete p;  // 销毁无效连接
-                }
-                cv.notify_all();
-            });
-        } else {
-            _connectionCnt--;
-            delete pcon;  // 清理无效连接
-        }
+    return getConnection(chrono::milliseconds(currentConfig().connectionTimeout));
+}
+
+// 最多等待timeout获取连接
+shared_ptr<Connection> ConnectionPool::getConnection(chrono::milliseconds timeout, BorrowPriority prio) {
+    return getConnection(chrono::steady_clock::now() + timeout, prio);
+}
+
+// 在绝对截止时间前获取连接
+shared_ptr<Connection> ConnectionPool::getConnection(chrono::steady_clock::time_point deadline,
+                                                     BorrowPriority prio) {
+    return wrapConnection(borrowConnection(deadline, prio));
+}
+
+// 立即返回：没有可用空闲连接时返回nullptr，从不等待
+shared_ptr<Connection> ConnectionPool::tryGetConnection(BorrowPriority prio) {
+    return wrapConnection(tryBorrowConnection(prio));
+}
+
+// 按连接池默认超时时间借出连接句柄
+PooledConnection ConnectionPool::borrowConnection() {
+    return borrowConnection(chrono::milliseconds(currentConfig().connectionTimeout));
+}
+
+// 最多等待timeout借出连接句柄
+PooledConnection ConnectionPool::borrowConnection(chrono::milliseconds timeout, BorrowPriority prio) {
+    return borrowConnection(chrono::steady_clock::now() + timeout, prio);
+}
+
+// 在绝对截止时间前借出连接句柄
+PooledConnection ConnectionPool::borrowConnection(chrono::steady_clock::time_point deadline,
+                                                  BorrowPriority prio) {
+    Connection* p = acquireConnection(deadline, true, prio);
+    return PooledConnection(p != nullptr ? this : nullptr, p, prio);
+}
+
+// 立即返回：没有可用空闲连接时句柄为空，从不等待
+PooledConnection ConnectionPool::tryBorrowConnection(BorrowPriority prio) {
+    Connection* p = acquireConnection(chrono::steady_clock::time_point::min(), false, prio);
+    return PooledConnection(p != nullptr ? this : nullptr, p, prio);
+}
+
+// 兼容接口：把连接句柄转换为shared_ptr，析构时自动归还连接池
+shared_ptr<Connection> ConnectionPool::wrapConnection(PooledConnection&& handle) {
+    BorrowPriority prio = handle._prio;
+    Connection* p = handle.release();
+    if (p == nullptr) {
+        return nullptr;
     }
-    return nullptr;
+    return shared_ptr<Connection>(p, [this, prio](Connection* c) {
+        releaseConnection(c, prio);
+    });
 }
 
 /**
- * @brief 连接生产线程主函数
- * @details 在独立后台线程中运行，负责动态创建并维护数据库连接：
- *          1. 当连接池为空或连接数未达上限时，创建新连接
- *          2. 确保连接总数不超过配置的最大限制(_maxSize)
- *          3. 自动处理连接创建失败的情况
- *          4. 通过条件变量实现高效等待/通知机制
- * 
- * @note 关键实现细节：
- *       - 使用unique_lock配合条件变量实现线程安全等待
- *       - 等待条件：连接池空或未达最大连接数(_connectionCnt < _maxSize)
- *       - 创建新连接过程：
- *         * 加锁状态下创建Connection对象
- *         * 尝试建立实际数据库连接
- *         * 成功则刷新时间戳并加入队列
- *         * 失败则立即释放资源
- *       - 捕获所有异常避免线程意外退出
- *       - 每次操作后通过notify_all通知可能等待的消费者
- * 
- * @warning 注意事项：
- *          - 必须保证线程安全（所有共享数据访问加锁）
- *          - 连接创建失败时应妥善释放资源
- *          - 死循环确保线程持续运行
- *          - 异常处理避免线程崩溃
+ * @brief 从连接池获取一个可用连接
+ * @details 0. 配置了预留容量时先做准入检查，本优先级已达上限则直接进入等待队列
+ *          1. 启用线程缓存时，先取当前线程上次归还的连接，不触碰任何共享状态
+ *          2. 快速路径：无锁地从本线程归属分片弹出空闲连接，归属分片为空时
+ *             依次从其他分片窃取，全程不加锁
+ *          3. 慢速路径：队列为空时才加锁(wait为false时直接返回)，按(优先级, 截止时间)
+ *             登记到等待队列，先回收所有线程缓存中的连接并分给等待者；仍未分到则通知生产者，
+ *             在自己的条件变量上等待，直到归还/新建的连接被直接交到自己手中或者超时
+ *          4. 按借出校验策略(test_on_borrow)在锁外检查连接，未通过的连接送入隔离区
+ *             由后台检查线程复查或关闭，借用方立即重试下一个连接
  * 
- * @param[in] void 无显式参数（通过类成员访问配置）
- * @return void 无返回值（无限循环执行）
+ * @note 等待者登记(_waitingCnt++)与归还方的入队之间通过seq_cst栅栏配对：
+ *       要么等待者登记后从空闲队列取到归还的连接，要么归还方看到等待者并加锁交接，
+ *       因此不会丢失唤醒；每个归还的连接只唤醒一个等待者，高优先级、截止时间早的优先
  */
-void ConnectionPool::produceConnectionTask() {
-    // 无限循环保持线程持续运行
+Connection* ConnectionPool::acquireConnection(chrono::steady_clock::time_point deadline, bool wait,
+                                              BorrowPriority prio) {
+    if (_shards.empty()) {
+        LOG("连接池未正确初始化");
+        t_lastError = PoolError::NotInitialized;
+        return nullptr;
+    }
+    if (_closing.load(memory_order_relaxed)) {
+        t_lastError = PoolError::Closed;
+        return nullptr;
+    }
+
+    PriorityCounters& stats = _priorityStats[static_cast<int>(prio)];
+    stats.borrows.fetch_add(1, memory_order_relaxed);
     for (;;) {
-        // 加锁并等待生产条件（自动释放锁等待，唤醒后重新获取）
-        unique_lock<mutex> lock(_queueMutex);
-        // 等待条件：连接池空或连接数未达最大连接数
-        cv.wait(lock, [this] { 
-            return _connectionQue.empty() || _connectionCnt < _maxSize; 
-        });
-
-        // 检查是否允许创建新连接（可能被虚假唤醒）
-        if (_connectionCnt < _maxSize) {
-            try {
-                // 创建新连接对象
-                Connection* p = new Connection();
-                
-                // 尝试建立实际数据库连接
-                if (p->connect(_ip, _port, _username, _password, _dbname)) {
-                    // 连接成功：记录时间戳并加入队列
-                    p->refreshAliveTime();
-                    _connectionQue.push(p);
-                    _connectionCnt++; // 原子计数器递增
-                } else {
-                    // 连接失败：立即释放资源
-                    delete p;  
+        Connection* pcon = takeAvailableConnection(prio);
+        if (pcon == nullptr) {
+            if (!wait) {
+                t_lastError = PoolError::Exhausted;
+                return nullptr;
+            }
+            // 后端不可用或连接池正在关闭：没有空闲连接时立即失败，不等待建连
+            if (rejectingBorrows()) {
+                rejectBorrow(stats);
+                return nullptr;
+            }
+
+            // 慢速路径：没有可用连接或本优先级已达上限，登记为等待者
+            auto waitStart = chrono::steady_clock::now();
+            unique_lock<mutex> lock(_queueMutex);
+            Waiter self;
+            self.prio = prio;
+            self.deadline = deadline;
+            self.seq = _waiterSeq++;
+            _waiters.insert(&self);
+            _waitingCnt++;
+            atomic_thread_fence(memory_order_seq_cst);
+            if (_threadCacheEnabled) {
+                spillThreadCaches(true);
+            }
+            handOffIdleLocked();
+            if (_asyncReadyCnt.load() > 0) {
+                // 交接时可能完成了排在前面的异步等待者，其回调不能在锁内执行
+                lock.unlock();
+                runAsyncCompletions();
+                lock.lock();
+            }
+
+            if (self.conn == nullptr) {
+                _produceCv.notify_one();
+            }
+            // 断路器在登记之后断开或连接池开始关闭时，abortWaiters()会唤醒所有等待者
+            while (self.conn == nullptr) {
+                bool rejected = rejectingBorrows();
+                if (rejected || (cv_status::timeout == self.cv.wait_until(lock, deadline) &&
+                                 self.conn == nullptr)) {
+                    _waiters.erase(&self);
+                    _waitingCnt--;
+                    lock.unlock();
+                    recordWait(stats, waitStart);
+                    if (rejected) {
+                        rejectBorrow(stats);
+                    } else {
+                        stats.timeouts.fetch_add(1, memory_order_relaxed);
+                        t_lastError = PoolError::Timeout;
+                        LOG("获取连接超时");
+                    }
+                    return nullptr;
                 }
-            } catch (...) {
-                // 捕获所有异常，防止线程退出
-                LOG("创建连接异常");
             }
+            pcon = self.conn;
+            lock.unlock();
+            recordWait(stats, waitStart);
+        }
+
+        // 检查存活时间并按借出校验策略检查连接有效性(锁外进行)，不可用时取下一个
+        if (checkBorrowedConnection(pcon, prio)) {
+            onBorrowed(pcon);
+            t_lastError = PoolError::None;
+            return pcon;
         }
-        
-        // 通知可能等待的消费者线程
-        cv.notify_all();
     }
 }
 
+// 快速路径：准入通过后依次尝试线程缓存和空闲队列，全程不加锁；取不到时释放准入名额
+Connection* ConnectionPool::takeAvailableConnection(BorrowPriority prio) {
+    if (!admitBorrow(prio)) {
+        return nullptr;
+    }
+
+    Connection* pcon = nullptr;
+    // 线程缓存：同一线程取回自己上次归还的连接
+    if (_threadCacheEnabled) {
+        pcon = localCacheSlot()->conn.exchange(nullptr, memory_order_acquire);
+    }
+    // 快速路径：存在空闲连接时不加锁
+    if (pcon == nullptr && !popIdleConnection(pcon)) {
+        finishBorrow(prio);
+        return nullptr;
+    }
+    return pcon;
+}
+
+// 按连接池默认超时时间异步获取连接
+void ConnectionPool::asyncGetConnection(AcquireCallback cb) {
+    asyncGetConnection(move(cb), chrono::milliseconds(currentConfig().connectionTimeout));
+}
 
 /**
- * @brief 空闲连接回收线程主函数
- * @details 定期扫描并回收空闲超时的数据库连接，保持连接池健康状态：
- *          1. 定时扫描（间隔=_maxIdleTime）
- *          2. 只回收超过最大空闲时间的连接
- *          3. 保证连接池至少保持_initSize个连接
- *          4. 采用安全的方式销毁连接（避免长时间持锁）
- * 
- * @note 关键实现细节：
- *       - 扫描周期与_maxIdleTime相同，保证及时回收
- *       - 先检查连接数是否大于_initSize，避免过度回收
- *       - 队列有序性：队头是最早创建的连接，只需检查队头
- *       - 销毁连接时临时释放锁，减少锁的持有时间
- *       - 使用while循环保证持续运行
- * 
- * @warning 注意事项：
- *          - 必须保证线程安全（所有共享数据访问加锁）
- *          - 连接销毁时要先释放锁，避免阻塞其他线程
- *          - 保持至少_initSize个连接是硬性要求
- *          - 死循环确保线程持续运行
+ * @brief 异步获取连接
+ * @details 1. 快速路径与同步接口相同，取到并通过借出校验时直接在调用线程执行回调
+ *          2. 否则登记一个异步等待者后立即返回，不阻塞调用线程；
+ *             之后由归还/新建连接的线程在释放连接池锁后执行回调，
+ *             超时由维护线程以空句柄执行回调
  */
-void ConnectionPool::scannerConnectionTask() {
-    // 无限循环保持线程持续运行
+void ConnectionPool::asyncGetConnection(AcquireCallback cb, chrono::milliseconds timeout,
+                                        BorrowPriority prio) {
+    if (_shards.empty()) {
+        LOG("连接池未正确初始化");
+        t_lastError = PoolError::NotInitialized;
+        cb(PooledConnection());
+        return;
+    }
+    if (_closing.load(memory_order_relaxed)) {
+        t_lastError = PoolError::Closed;
+        cb(PooledConnection());
+        return;
+    }
+
+    PriorityCounters& stats = _priorityStats[static_cast<int>(prio)];
+    stats.borrows.fetch_add(1, memory_order_relaxed);
+    Connection* p = takeAvailableConnection(prio);
+    if (p != nullptr && checkBorrowedConnection(p, prio)) {
+        onBorrowed(p);
+        t_lastError = PoolError::None;
+        cb(PooledConnection(this, p, prio));
+        return;
+    }
+    if (rejectingBorrows()) {
+        rejectBorrow(stats);
+        cb(PooledConnection());
+        return;
+    }
+
+    Waiter* w = new Waiter;
+    w->prio = prio;
+    w->deadline = chrono::steady_clock::now() + timeout;
+    w->callback = move(cb);
+    submitAsyncWaiter(w);
+}
+
+#if __cplusplus >= 202002L
+// 协程接口：按连接池默认超时时间获取连接
+AcquireAwaitable ConnectionPool::acquire() {
+    return acquire(chrono::milliseconds(currentConfig().connectionTimeout));
+}
+
+// 协程接口
+AcquireAwaitable ConnectionPool::acquire(chrono::milliseconds timeout, BorrowPriority prio) {
+    return AcquireAwaitable(this, timeout, prio);
+}
+#endif
+
+// 按连接池默认超时时间异步获取连接，结果通过future返回
+future<PooledConnection> ConnectionPool::asyncGetConnection() {
+    return asyncGetConnection(chrono::milliseconds(currentConfig().connectionTimeout));
+}
+
+// future版本：超时时future的值为空句柄
+future<PooledConnection> ConnectionPool::asyncGetConnection(chrono::milliseconds timeout,
+                                                            BorrowPriority prio) {
+    auto promised = make_shared<promise<PooledConnection>>();
+    future<PooledConnection> result = promised->get_future();
+    asyncGetConnection([promised](PooledConnection conn) {
+        promised->set_value(move(conn));
+    }, timeout, prio);
+    return result;
+}
+
+/**
+ * @brief 登记异步等待者(所有权转交连接池)
+ * @details 与同步等待者共用同一等待队列和交接路径，另登记到按截止时间排序的
+ *          _asyncWaiters中，维护线程据此处理超时；截止时间早于维护线程下次醒来的时间时唤醒它
+ */
+void ConnectionPool::submitAsyncWaiter(Waiter* w) {
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        w->seq = _waiterSeq++;
+        w->since = chrono::steady_clock::now();
+        _waiters.insert(w);
+        _asyncWaiters.insert(w);
+        _waitingCnt++;
+        atomic_thread_fence(memory_order_seq_cst);
+        if (_threadCacheEnabled) {
+            spillThreadCaches(true);
+        }
+        handOffIdleLocked();
+
+        if (w->conn == nullptr && rejectingBorrows()) {
+            // 登记前断路器已断开或连接池开始关闭：立即以空句柄完成(completeAsyncWaiter按拒绝处理)
+            _waiters.erase(w);
+            _asyncWaiters.erase(w);
+            _waitingCnt--;
+            _asyncReady.push_back(w);
+            _asyncReadyCnt = (int)_asyncReady.size();
+        } else if (w->conn == nullptr) {
+            _produceCv.notify_one();
+            if (w->deadline < _maintenanceDue) {
+                _maintenanceCv.notify_one();
+            }
+        }
+    }
+    runAsyncCompletions();
+}
+
+// 在不持有任何锁的情况下执行已完成的异步等待者的回调
+void ConnectionPool::runAsyncCompletions() {
+    while (_asyncReadyCnt.load() > 0) {
+        vector<Waiter*> ready;
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            ready.swap(_asyncReady);
+            _asyncReadyCnt = 0;
+        }
+        for (Waiter* w : ready) {
+            completeAsyncWaiter(w);
+        }
+    }
+}
+
+// 完成一个异步等待者：校验交接到的连接后执行回调，连接失效且未超时时重新登记
+void ConnectionPool::completeAsyncWaiter(Waiter* w) {
+    unique_ptr<Waiter> owner(w);
+    PriorityCounters& stats = _priorityStats[static_cast<int>(w->prio)];
+    Connection* p = w->conn;
+    if (p != nullptr && !checkBorrowedConnection(p, w->prio)) {
+        w->conn = nullptr;
+        if (chrono::steady_clock::now() < w->deadline) {
+            submitAsyncWaiter(owner.release());
+            return;
+        }
+    }
+
+    recordWait(stats, w->since);
+    if (p == nullptr || w->conn == nullptr) {
+        if (rejectingBorrows() && chrono::steady_clock::now() < w->deadline) {
+            rejectBorrow(stats);
+        } else {
+            stats.timeouts.fetch_add(1, memory_order_relaxed);
+            t_lastError = PoolError::Timeout;
+            LOG("异步获取连接超时");
+        }
+        w->callback(PooledConnection());
+        return;
+    }
+    onBorrowed(p);
+    t_lastError = PoolError::None;
+    w->callback(PooledConnection(this, p, w->prio));
+}
+
+// 维护线程调用：异步等待者超过截止时间时出队，并以空句柄执行回调
+void ConnectionPool::expireAsyncWaiters() {
+    vector<Waiter*> expired;
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        auto now = chrono::steady_clock::now();
+        while (!_asyncWaiters.empty() && (*_asyncWaiters.begin())->deadline <= now) {
+            Waiter* w = *_asyncWaiters.begin();
+            _asyncWaiters.erase(_asyncWaiters.begin());
+            _waiters.erase(w);
+            _waitingCnt--;
+            expired.push_back(w);
+        }
+    }
+    for (Waiter* w : expired) {
+        completeAsyncWaiter(w);
+    }
+}
+
+/**
+ * @brief 一次性借出k个连接(全有或全无)
+ * @details 1. 只加一次锁完成登记：在等待队列中登记一个需要k个连接的批量等待者，
+ *             把当前空闲连接按队列顺序分配，前面没有其他等待者且空闲足够时当场凑齐
+ *          2. 凑不齐则等待后续归还/新建的连接；同一时刻只有一个批量等待者能累积连接，
+ *             不会出现两个批量请求各持一半而互相等待的情况
+ *          3. 超时则把已累积的连接全部交还连接池，返回空的ConnectionGroup
+ *          4. 凑齐后在锁外按借出策略逐个校验；有连接未通过时全部交还并重新获取
+ */
+ConnectionGroup ConnectionPool::getConnections(int k, chrono::milliseconds timeout,
+                                               BorrowPriority prio) {
+    if (_shards.empty() || k <= 0 || k > currentConfig().maxSize) {
+        LOG("批量获取连接参数非法: k=" << k);
+        t_lastError = _shards.empty() ? PoolError::NotInitialized : PoolError::InvalidArgument;
+        return ConnectionGroup();
+    }
+    if (_closing.load(memory_order_relaxed)) {
+        t_lastError = PoolError::Closed;
+        return ConnectionGroup();
+    }
+
+    PriorityCounters& stats = _priorityStats[static_cast<int>(prio)];
+    stats.borrows.fetch_add(1, memory_order_relaxed);
+    auto waitStart = chrono::steady_clock::now();
+    auto deadline = waitStart + timeout;
     for (;;) {
-        // 定时扫描（间隔=maxIdleTime）
-        this_thread::sleep_for(chrono::seconds(_maxIdleTime));
-
-        // 加锁扫描空闲连接
-        unique_lock<mutex> lock(_queueMutex);
-        
-        // 只回收超出初始数量的连接（保持最小连接数）
-        while (_connectionCnt > _initSize) {
-            Connection* p = _connectionQue.front();
-            
-            // 检查队头连接是否超时（毫秒比较）
-            if (p->getAliveeTime() >= (_maxIdleTime * 1000)) {
-                _connectionQue.pop();  // 从队列移除
-                _connectionCnt--;     // 总数减1
-                
-                // 关键！释放锁后再销毁连接
+        Waiter self;
+        self.prio = prio;
+        self.need = k;
+        self.deadline = deadline;
+        {
+            unique_lock<mutex> lock(_queueMutex);
+            self.seq = _waiterSeq++;
+            _waiters.insert(&self);
+            _waitingCnt++;
+            atomic_thread_fence(memory_order_seq_cst);
+            if (_threadCacheEnabled) {
+                spillThreadCaches(true);
+            }
+            handOffIdleLocked();
+            if (_asyncReadyCnt.load() > 0) {
                 lock.unlock();
-                delete p;  // 实际销毁连接（可能耗时）
-                lock.lock(); // 继续处理前重新加锁
-            } else {
-                // 队头未超时则后续连接也不会超时（队列有序）
-                break; 
+                runAsyncCompletions();
+                lock.lock();
+            }
+
+            if (self.group.size() < self.need) {
+                _produceCv.notify_one();
+            }
+            while (self.group.size() < self.need) {
+                bool rejected = rejectingBorrows();
+                if (rejected || (cv_status::timeout == self.cv.wait_until(lock, deadline) &&
+                                 self.group.size() < self.need)) {
+                    // 超时、断路器断开或连接池关闭：退出等待队列并交还已累积的连接
+                    _waiters.erase(&self);
+                    _waitingCnt--;
+                    if (_groupAccumulator == &self) {
+                        _groupAccumulator = nullptr;
+                    }
+                    for (Connection* p : self.group) {
+                        finishBorrow(prio);
+                        if (!handOffLocked(p)) {
+                            enqueueIdleConnection(p, homeShard());
+                        }
+                    }
+                    lock.unlock();
+                    runAsyncCompletions();
+                    recordWait(stats, waitStart);
+                    if (rejected) {
+                        rejectBorrow(stats);
+                    } else {
+                        stats.timeouts.fetch_add(1, memory_order_relaxed);
+                        t_lastError = PoolError::Timeout;
+                        LOG("批量获取" << k << "个连接超时");
+                    }
+                    return ConnectionGroup();
+                }
+            }
+        }
+
+        // 锁外校验，任一连接失效则全部交还后重试
+        bool allValid = true;
+        for (Connection*& p : self.group) {
+            if (!checkBorrowedConnection(p, prio)) {
+                p = nullptr;
+                allValid = false;
+            }
+        }
+        if (allValid) {
+            for (Connection* p : self.group) {
+                onBorrowed(p);
+            }
+            recordWait(stats, waitStart);
+            t_lastError = PoolError::None;
+            return ConnectionGroup(this, move(self.group), prio);
+        }
+        for (Connection* p : self.group) {
+            if (p != nullptr) {
+                finishBorrow(prio);
+                pushIdleConnection(p);
             }
         }
+        if (chrono::steady_clock::now() >= deadline) {
+            stats.timeouts.fetch_add(1, memory_order_relaxed);
+            recordWait(stats, waitStart);
+            t_lastError = PoolError::Timeout;
+            LOG("批量获取" << k << "个连接超时");
+            return ConnectionGroup();
+        }
+    }
+}
+
+// 借出连接时的公共处理
+void ConnectionPool::onBorrowed(Connection* p) {
+    p->refreshAliveTime();
+    if (_autoSize) {
+        p->markBorrowed();
+        // 记录本周期借出数的峰值，缩容时按峰值需求保留连接
+        int inUse = _inUse.fetch_add(1, memory_order_relaxed) + 1;
+        int peak = _inUsePeak.load(memory_order_relaxed);
+        while (inUse > peak && !_inUsePeak.compare_exchange_weak(peak, inUse, memory_order_relaxed)) {
+        }
     }
+    // 空闲连接(含建立中的)低于min_idle时提前补充，避免下一个借用方等待握手
+    const PoolConfig& cfg = currentConfig();
+    if (cfg.minIdle > 0 && _connectionCnt < cfg.maxSize
+        && (int)idleCount() + _pendingConnects < cfg.minIdle) {
+        notifyProducer();
+    }
+}
+
+// 归还连接时累计占用时长，由维护线程按周期换算为平均值
+void ConnectionPool::recordHoldTime(Connection* p) {
+    _inUse.fetch_sub(1, memory_order_relaxed);
+    _holdNsTotal.fetch_add(p->borrowedFor().count(), memory_order_relaxed);
+    _holdSamples.fetch_add(1, memory_order_relaxed);
 }
 
+// 归还连接：有效连接优先放入线程缓存，其次交给等待者或放回空闲队列，可疑连接送入隔离区
+void ConnectionPool::releaseConnection(Connection* p, BorrowPriority prio) {
+    finishBorrow(prio);
+    if (_autoSize) {
+        recordHoldTime(p);
+    }
+
+    // 关闭期间归还的连接由归还方直接关闭，并通知shutdown()
+    if (_closing.load()) {
+        destroyConnection(p);
+        lock_guard<mutex> lock(_queueMutex);
+        _drainCv.notify_all();
+        return;
+    }
 
+    // max_size调小后超出上限的连接直接关闭；超过最长存活时间或连接目标已变更的连接退役，
+    // 两者都不再投入使用，也不必做归还校验
+    if (shedExcessConnection(p)) {
+        return;
+    }
+    ResizeReason reason;
+    if (shouldRetire(p, reason)) {
+        retireConnection(p, reason);
+        return;
+    }
 
+    if (validateConnection(p, currentConfig().returnValidation)) {  // 只有有效连接才放回队列
+        p->refreshAliveTime();
 
+        // 没有等待者且本线程缓存槽为空时，留给本线程下次使用
+        if (_threadCacheEnabled && _waitingCnt.load(memory_order_relaxed) == 0) {
+            ThreadCacheSlot* slot = localCacheSlot();
+            if (slot->conn.load(memory_order_relaxed) == nullptr) {
+                slot->stashedAt.store(steadyNowMs(), memory_order_relaxed);
+                slot->conn.store(p, memory_order_release);
 
+                // 与等待者登记配对：若期间出现等待者，把连接取回交给等待者
+                atomic_thread_fence(memory_order_seq_cst);
+                if (_waitingCnt.load() > 0) {
+                    Connection* back = slot->conn.exchange(nullptr, memory_order_acquire);
+                    if (back != nullptr) {
+                        pushIdleConnection(back);
+                    }
+                }
+                return;
+            }
+        }
 
-// 析构函数
-ConnectionPool::~ConnectionPool() {
-    unique_lock<mutex> lock(_queueMutex);
-    while (!_connectionQue.empty()) {
-        delete _connectionQue.front();
-        _connectionQue.pop();
+        pushIdleConnection(p);
+        return;
+    }
+
+    quarantineConnection(p);
+
+    // 释放了准入名额：被上限挡住的低优先级等待者可能可以使用现有空闲连接了
+    if (_reservationEnabled) {
+        wakeWaiters();
     }
-    _connectionCnt = 0;
 }
 
+/**
+ * @brief 借出准入检查
+ * @details _borrowedAtOrBelow[j]记录优先级j及更低优先级当前借出的连接数，
+ *          其上限_priorityLimit[j] = max_size - 比j更高的各优先级预留数之和。
+ *          优先级c借出时对所有j<=c的计数加一，任一超限即全部回滚并拒绝，
+ *          从而保证高优先级始终至少有其预留数量的连接可用
+ */
+bool ConnectionPool::admitBorrow(BorrowPriority prio) {
+    if (!_reservationEnabled) {
+        return true;
+    }
 
-// 打印线程池信息
-void ConnectionPool::printStats() const {
-    unique_lock<mutex> lock(_queueMutex);
-    cout << "连接池状态: " 
-         << "总数=" << _connectionCnt 
-         << ", 空闲=" << _connectionQue.size()
-         << endl;
+    int c = static_cast<int>(prio);
+    for (int j = c; j >= 0; --j) {
+        if (_borrowedAtOrBelow[j].fetch_add(1) >= _priorityLimit[j]) {
+            for (int k = c; k >= j; --k) {
+                _borrowedAtOrBelow[k].fetch_sub(1);
+            }
+            return false;
+        }
+    }
+    return true;
 }
 
+// 归还准入名额
+void ConnectionPool::finishBorrow(BorrowPriority prio) {
+    if (!_reservationEnabled) {
+        return;
+    }
 
+    for (int j = static_cast<int>(prio); j >= 0; --j) {
+        _borrowedAtOrBelow[j].fetch_sub(1);
+    }
+}
+
+// 记录一次进入慢速路径的等待耗时
+void ConnectionPool::recordWait(PriorityCounters& stats, chrono::steady_clock::time_point start) {
+    int64_t waited = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - start).count();
+    stats.waits.fetch_add(1, memory_order_relaxed);
+    stats.totalWaitUs.fetch_add(waited, memory_order_relaxed);
+    int64_t prev = stats.maxWaitUs.load(memory_order_relaxed);
+    while (waited > prev && !stats.maxWaitUs.compare_exchange_weak(prev, waited)) {
+    }
+}
+
+// 获取某个优先级的等待统计
+PriorityStats ConnectionPool::getPriorityStats(BorrowPriority prio) const {
+    const PriorityCounters& c = _priorityStats[static_cast<int>(prio)];
+    PriorityStats stats;
+    stats.borrows = c.borrows.load();
+    stats.waits = c.waits.load();
+    stats.timeouts = c.timeouts.load();
+    stats.rejected = c.rejected.load();
+    stats.totalWaitUs = c.totalWaitUs.load();
+    stats.maxWaitUs = c.maxWaitUs.load();
+    stats.reserved = _priorityReserve[static_cast<int>(prio)];
+    return stats;
+}
+
+// 获取连接池大小决策的统计
+SizingStats ConnectionPool::getSizingStats() const {
+    SizingStats stats;
+    stats.target = _targetSize.load();
+    stats.minIdle = currentConfig().minIdle;
+    stats.autoSize = _autoSize;
+    stats.arrivalRate = _arrivalRate.load();
+    stats.avgHoldMs = _avgHoldMs.load();
+    for (int i = 0; i < kResizeReasonCount; ++i) {
+        stats.resizes[i] = _resizeCounts[i].load();
+    }
+    stats.lastReason = _lastResize.load();
+    return stats;
+}
+
+// 获取断路器状态和统计
+BreakerStats ConnectionPool::getBreakerStats() const {
+    BreakerStats stats = _breaker.stats();
+    for (int i = 0; i < kPriorityCount; ++i) {
+        stats.rejected += _priorityStats[i].rejected.load();
+    }
+    return stats;
+}
+
+// 断路器断开或连接池关闭时拒绝借用：不登记等待者，调用方立即得到空连接
+void ConnectionPool::rejectBorrow(PriorityCounters& stats) {
+    if (_closing.load(memory_order_relaxed)) {
+        t_lastError = PoolError::Closed;
+        return;
+    }
+    stats.rejected.fetch_add(1, memory_order_relaxed);
+    t_lastError = PoolError::BackendUnavailable;
+}
+
+// 记录一次扩缩容
+void ConnectionPool::recordResize(ResizeReason reason, uint64_t count) {
+    _resizeCounts[static_cast<int>(reason)].fetch_add(count, memory_order_relaxed);
+    _lastResize.store(static_cast<int>(reason), memory_order_relaxed);
+}
+
+// 退役连接交给检查线程关闭(mysql_close可能涉及网络I/O，不在业务线程上进行)，
+// 同时请求建连线程在后台补充一个新连接
+void ConnectionPool::retireConnection(Connection* p, ResizeReason reason) {
+    recordResize(reason);
+    _replacements++;
+    notifyProducer();
+
+    lock_guard<mutex> lock(_quarantineMutex);
+    _retiring.push_back(p);
+    _quarantineCv.notify_one();
+}
+
+bool ConnectionPool::shouldRetire(Connection* p, ResizeReason& reason) const {
+    if (currentConfig().maxLifetime > 0 && p->isExpired()) {
+        reason = ResizeReason::Lifetime;
+        return true;
+    }
+    if (p->generation() != _generation.load(memory_order_acquire)) {
+        reason = ResizeReason::Reload;
+        return true;
+    }
+    return false;
+}
+
+// 连接总数超过max_size时把归还的连接交给检查线程关闭，不请求补充；
+// 关闭前仍计入_connectionCnt，已决定关闭的计入_shedding，并发归还不会多关
+bool ConnectionPool::shedExcessConnection(Connection* p) {
+    const int maxSize = currentConfig().maxSize;
+    if (_connectionCnt.load() - _shedding.load() <= maxSize) {
+        return false;
+    }
+    {
+        lock_guard<mutex> lock(_quarantineMutex);
+        if (_connectionCnt.load() - _shedding.load() <= maxSize) {
+            return false;
+        }
+        _shedding++;
+        _retiring.push_back(p);
+        _quarantineCv.notify_one();
+    }
+    recordResize(ResizeReason::Reload);
+    return true;
+}
+
+// 借出前检查连接：到期或连接目标已变更的退役，借出校验未通过的送入隔离区(均不在借用路径上关闭)
+bool ConnectionPool::checkBorrowedConnection(Connection* p, BorrowPriority prio) {
+    ResizeReason reason;
+    if (shouldRetire(p, reason)) {
+        finishBorrow(prio);
+        retireConnection(p, reason);
+        return false;
+    }
+    if (validateConnection(p, currentConfig().borrowValidation)) {
+        return true;
+    }
+    finishBorrow(prio);
+    quarantineConnection(p);
+    return false;
+}
+
+// 可疑连接送入隔离区，由检查线程复查(仍计入连接总数，避免生产者超额创建)
+void ConnectionPool::quarantineConnection(Connection* p) {
+    lock_guard<mutex> lock(_quarantineMutex);
+    _quarantine.push_back(p);
+    _quarantineCv.notify_one();
+}
+
+/**
+ * @brief 按校验策略检查连接是否可用
+ * @details - Never：不检查，零网络往返
+ *          - IdleTime：距上次活动不足_validationIdleTime毫秒时直接认为可用，
+ *            否则执行validation_query(未配置时用mysql_ping)
+ *          - Ping：每次mysql_ping
+ *          - Query：每次执行validation_query
+ */
+bool ConnectionPool::validateConnection(Connection* p, ValidationPolicy policy) const {
+    const PoolConfig& cfg = currentConfig();
+    switch (policy) {
+    case ValidationPolicy::Never:
+        return true;
+    case ValidationPolicy::IdleTime:
+        if (p->getAliveeTime() < cfg.validationIdleTime) {
+            return true;
+        }
+        return cfg.validationQuery.empty() ? p->isValid() : p->validate(cfg.validationQuery);
+    case ValidationPolicy::Ping:
+        return p->isValid();
+    case ValidationPolicy::Query:
+        return p->validate(cfg.validationQuery);
+    }
+    return p->isValid();
+}
+
+// 当前线程的归属分片：线程首次访问时按序号轮转分配
+size_t ConnectionPool::homeShard() const {
+    static thread_local size_t threadIndex = s_nextThreadIndex++;
+    return threadIndex % _shards.size();
+}
+
+// 无锁取空闲连接：先取归属分片，为空时从其他分片窃取
+bool ConnectionPool::popIdleConnection(Connection*& p) {
+    size_t n = _shards.size();
+    size_t home = homeShard();
+    for (size_t i = 0; i < n; ++i) {
+        if (_shards[(home + i) % n]->idle.pop(p)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 所有分片的空闲连接总数(近似值)
+size_t ConnectionPool::idleCount() const {
+    size_t idle = 0;
+    for (const auto& shard : _shards) {
+        idle += shard->idle.size();
+    }
+    return idle;
+}
+
+// 空闲连接无锁入队：队列短暂显示已满时让出CPU重试，确实已满则销毁连接
+bool ConnectionPool::enqueueIdleConnection(Connection* p, size_t shard) {
+    for (int retry = 0; retry < 64; ++retry) {
+        if (_shards[shard]->idle.push(p)) {
+            return true;
+        }
+        this_thread::yield();
+    }
+
+    // 队列容量远大于连接总数，正常情况下不会走到这里
+    LOG("空闲连接队列已满，销毁连接");
+    destroyConnection(p);
+    return false;
+}
+
+// 归还/新建的空闲连接：有等待者时直接交给排在最前的等待者，否则无锁入队
+void ConnectionPool::pushIdleConnection(Connection* p) {
+    // 关闭期间建立完成或复查通过的连接不再入队
+    if (_closing.load()) {
+        destroyConnection(p);
+        lock_guard<mutex> lock(_queueMutex);
+        _drainCv.notify_all();
+        return;
+    }
+    if (_waitingCnt.load() > 0) {
+        bool handed;
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            handed = handOffLocked(p);
+        }
+        if (handed) {
+            runAsyncCompletions();
+            return;
+        }
+    }
+
+    if (!enqueueIdleConnection(p, homeShard())) {
+        return;
+    }
+    wakeWaiters();
+}
+
+// 与等待者登记配对：入队后若发现等待者，把空闲连接交给它们
+void ConnectionPool::wakeWaiters() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (_waitingCnt.load() > 0) {
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            handOffIdleLocked();
+        }
+        runAsyncCompletions();
+    }
+}
+
+/**
+ * @brief 按队列顺序找到第一个有资格接收连接的等待者，并为其完成准入
+ * @details 等待队列按(优先级, 截止时间, 登记顺序)排序，跳过：
+ *          - 本优先级已达借出上限(预留给更高优先级)的等待者
+ *          - 非当前累积者的批量等待者：同一时刻只允许一个批量等待者(_groupAccumulator)
+ *            累积连接，避免多个批量请求各持一部分连接互相等待
+ * @return 有资格的等待者迭代器，没有则返回end()
+ * @note 调用方必须持有_queueMutex
+ */
+set<ConnectionPool::Waiter*, ConnectionPool::WaiterOrder>::iterator ConnectionPool::pickWaiterLocked() {
+    for (auto it = _waiters.begin(); it != _waiters.end(); ++it) {
+        Waiter* w = *it;
+        if (w->need > 1 && _groupAccumulator != nullptr && _groupAccumulator != w) {
+            continue;
+        }
+        if (admitBorrow(w->prio)) {
+            return it;
+        }
+    }
+    return _waiters.end();
+}
+
+// 把连接交给已选中的等待者：单连接等待者立即出队唤醒，批量等待者凑齐后才出队唤醒
+void ConnectionPool::deliverLocked(set<Waiter*, WaiterOrder>::iterator it, Connection* p) {
+    Waiter* w = *it;
+    if (w->need > 1) {
+        w->group.push_back(p);
+        if (w->group.size() < w->need) {
+            _groupAccumulator = w;
+            return;
+        }
+        _groupAccumulator = nullptr;
+    } else {
+        w->conn = p;
+    }
+    _waiters.erase(it);
+    _waitingCnt--;
+    if (w->callback) {
+        // 异步等待者：没有线程在等，放入完成列表，由调用方解锁后执行回调
+        _asyncWaiters.erase(w);
+        _asyncReady.push_back(w);
+        _asyncReadyCnt++;
+        return;
+    }
+    w->cv.notify_one();
+}
+
+// 把连接交给有资格的等待者(调用方持有_queueMutex)，没有有资格的等待者时返回false
+bool ConnectionPool::handOffLocked(Connection* p) {
+    auto it = pickWaiterLocked();
+    if (it == _waiters.end()) {
+        return false;
+    }
+    deliverLocked(it, p);
+    return true;
+}
+
+// 把空闲连接逐个交给有资格的等待者，每个等待者只被唤醒一次(调用方持有_queueMutex)
+void ConnectionPool::handOffIdleLocked() {
+    for (;;) {
+        auto it = pickWaiterLocked();
+        if (it == _waiters.end()) {
+            break;
+        }
+        Connection* p = nullptr;
+        if (!popIdleConnection(p)) {
+            finishBorrow((*it)->prio);
+            break;
+        }
+        deliverLocked(it, p);
+    }
+}
+
+// 销毁连接：先回收槽位，再归还连接名额
+void ConnectionPool::destroyConnection(Connection* p) {
+    _slab->deallocate(p);
+    _connectionCnt--;
+}
+
+// 连接总数减少后通知生产者补充
+void ConnectionPool::notifyProducer() {
+    lock_guard<mutex> lock(_queueMutex);
+    _produceCv.notify_one();
+}
+
+/**
+ * @brief 获取当前线程的缓存槽
+ * @details 线程本地登记表按连接池编号保存槽指针，首次访问时创建槽并登记到连接池；
+ *          线程退出时登记表析构，将其所有槽标记为abandoned，由维护线程回收其中的连接
+ */
+ConnectionPool::ThreadCacheSlot* ConnectionPool::localCacheSlot() {
+    struct Registry {
+        vector<pair<uint64_t, shared_ptr<ThreadCacheSlot>>> slots;
+        ~Registry() {
+            for (auto& entry : slots) {
+                entry.second->abandoned.store(true);
+            }
+        }
+    };
+    static thread_local Registry registry;
+
+    for (auto& entry : registry.slots) {
+        if (entry.first == _poolId) {
+            return entry.second.get();
+        }
+    }
+
+    auto slot = make_shared<ThreadCacheSlot>();
+    {
+        lock_guard<mutex> lock(_cacheMutex);
+        _cacheSlots.push_back(slot);
+    }
+    registry.slots.emplace_back(_poolId, slot);
+    return slot.get();
+}
+
+// 线程缓存溢出：闲置超时或所属线程已退出的连接放回全局队列
+size_t ConnectionPool::spillThreadCaches(bool force) {
+    int64_t now = steadyNowMs();
+    size_t spilled = 0;
+
+    lock_guard<mutex> lock(_cacheMutex);
+    for (auto it = _cacheSlots.begin(); it != _cacheSlots.end();) {
+        ThreadCacheSlot* slot = it->get();
+        bool abandoned = slot->abandoned.load();
+        if (force || abandoned ||
+            now - slot->stashedAt.load(memory_order_relaxed) >= currentConfig().threadCacheIdleTime) {
+            Connection* p = slot->conn.exchange(nullptr, memory_order_acquire);
+            if (p != nullptr && enqueueIdleConnection(p, homeShard())) {
+                spilled++;
+            }
+        }
+        it = abandoned ? _cacheSlots.erase(it) : it + 1;
+    }
+    return spilled;
+}
+
+/**
+ * @brief 为建连线程预占一个连接名额
+ * @details 由连接工厂的每个建连线程循环调用，决定何时需要新连接：
+ *          1. 连接数未达上限时预占一个名额后返回，建连线程随即在锁外握手
+ *          2. 确保连接总数(含握手中的)不超过配置的最大限制(max_size)
+ *          3. 使用独立的条件变量_produceCv等待，与借用方互不干扰
+ * 
+ * @note 关键实现细节：
+ *       - 使用unique_lock配合_produceCv实现线程安全等待
+ *       - 等待条件：未达最大连接数且确有需求(见needMoreConnections)，
+ *         不再预先把连接池填满到max_size；
+ *         借用方开始等待、空闲连接低于min_idle、连接被销毁、目标大小上调时会通知生产者
+ *       - 建连失败后的退避期内、令牌桶没有令牌时不建连，等到connectAllowedAt()再检查；
+ *         先检查限速再检查需求，避免半开探测已开始却因限速迟迟不发起
+ *       - 连续失败期间只允许一个建连在进行，不会多个建连线程同时撞向故障的后端
+ *       - 只在加锁状态下预占名额(_connectionCnt++)，随即释放锁；
+ *         多个建连线程各自预占，握手并发进行
+ *       - 握手失败时建连线程回收槽位并归还预占的名额
+ * 
+ * @return bool 预占成功返回true；连接池停止时返回false，建连线程随之退出
+ */
+bool ConnectionPool::tryReserveConnectionSlot() {
+    // 预热同样受退避和限速约束；后端不可用(断路器断开)时放弃预热，由建连线程在恢复后补齐
+    unique_lock<mutex> lock(_queueMutex);
+    for (;;) {
+        if (!_running || _connectionCnt >= currentConfig().maxSize || !_breaker.allowRequests()) {
+            return false;
+        }
+        auto now = chrono::steady_clock::now();
+        auto allowedAt = connectAllowedAt(now);
+        if (allowedAt <= now) {
+            _connectBucket.tryTake(now);
+            break;
+        }
+        _produceCv.wait_until(lock, allowedAt);
+    }
+    _connectionCnt++;
+    _pendingConnects++;
+    return true;
+}
+
+// 建连线程：阻塞直到需要新连接且退避、限速允许
+bool ConnectionPool::reserveConnectionSlot() {
+    unique_lock<mutex> lock(_queueMutex);
+    ResizeReason reason = ResizeReason::Target;
+    for (;;) {
+        if (!_running) {
+            return false;
+        }
+        auto now = chrono::steady_clock::now();
+        auto allowedAt = connectAllowedAt(now);
+        if (allowedAt > now) {
+            _produceCv.wait_until(lock, allowedAt);
+            continue;
+        }
+        // 连续失败期间同一时刻只发起一次试探性建连，成功后其他建连线程再并发补齐
+        if (_connectFailStreak > 0 && _pendingConnects > 0) {
+            _produceCv.wait(lock);
+            continue;
+        }
+        if (canConnect(reason)) {
+            _connectBucket.tryTake(now);
+            break;
+        }
+        // 自动释放锁等待，唤醒后重新获取
+        _produceCv.wait(lock);
+    }
+
+    // 预占名额后释放锁，网络I/O不在锁内进行
+    _connectionCnt++; // 原子计数器递增
+    _pendingConnects++;
+    if (reason == ResizeReason::Replacement) {
+        _replacements--;
+    }
+    recordResize(reason);
+    return true;
+}
+
+// 退避结束且令牌桶有令牌的时间
+chrono::steady_clock::time_point ConnectionPool::connectAllowedAt(chrono::steady_clock::time_point now) {
+    return max(_connectNotBefore, _connectBucket.availableAt(now));
+}
+
+// 建连成功：清零连续失败次数并结束退避
+void ConnectionPool::resetConnectBackoff() {
+    lock_guard<mutex> lock(_queueMutex);
+    if (_connectFailStreak > 0) {
+        _connectFailStreak = 0;
+        _connectNotBefore = chrono::steady_clock::time_point();
+        _produceCv.notify_all();
+    }
+}
+
+/**
+ * @brief 建连失败后的退避
+ * @details 第n次连续失败后等待base*2^(n-1)(不超过上限)的一半到全部之间的随机时长，
+ *          所有建连线程共享同一个退避结束时间：
+ *          - 后端宕机时不会在失败后立即重试，形成紧密循环
+ *          - 随机抖动使多个进程的连接池在后端重启后错开重连
+ *          任何一次建连成功都会清零连续失败次数并结束退避
+ */
+void ConnectionPool::backOffConnects() {
+    thread_local mt19937 rng(random_device{}());
+    _connectFailStreak++;
+    int shift = min(_connectFailStreak - 1, 20);
+    const PoolConfig& cfg = currentConfig();
+    int64_t ceiling = min<int64_t>(cfg.connectBackoffMax, (int64_t)cfg.connectBackoffBase << shift);
+    uniform_int_distribution<int64_t> dist(ceiling / 2, ceiling);
+    _connectNotBefore = max(_connectNotBefore,
+        chrono::steady_clock::now() + chrono::milliseconds(dist(rng)));
+}
+
+/**
+ * @brief 判断是否需要建立新连接(按优先顺序)
+ * @details 1. 等待者多于正在建立的连接：每个等待者最多对应一次建连
+ *          2. 有退役(超过max_lifetime)的连接等待补充
+ *          3. 空闲连接加上正在建立的连接低于min_idle
+ *          4. 连接数(含正在建立的)低于目标大小：不启用auto_size时为initial_size，
+ *             启用时为维护线程按Little定律估算的值
+ * @note 正在建立的连接已计入_connectionCnt，多个建连线程不会为同一需求重复建连
+ */
+bool ConnectionPool::needMoreConnections(ResizeReason& reason) const {
+    const PoolConfig& cfg = currentConfig();
+    if (_connectionCnt >= cfg.maxSize) {
+        return false;
+    }
+    int pending = _pendingConnects;
+    if (_waitingCnt > pending) {
+        reason = ResizeReason::Waiters;
+        return true;
+    }
+    if (_replacements > 0) {
+        reason = ResizeReason::Replacement;
+        return true;
+    }
+    if (cfg.minIdle > 0 && (int)idleCount() + pending < cfg.minIdle) {
+        reason = ResizeReason::MinIdle;
+        return true;
+    }
+    if (_connectionCnt < _targetSize) {
+        reason = ResizeReason::Target;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 建连线程是否可以建立新连接
+ * @details - Closed：按needMoreConnections()的需求建连
+ *          - Open：暂停建连；冷却结束后由第一个检查到的建连线程进入半开并探测一次，
+ *            探测不依赖借用需求(断开期间借用方立即失败，不会形成等待者)
+ *          - HalfOpen：探测进行中，其他建连线程继续等待结果
+ */
+bool ConnectionPool::canConnect(ResizeReason& reason) {
+    switch (_breaker.state()) {
+    case BreakerState::Closed:
+        return needMoreConnections(reason);
+    case BreakerState::Open:
+        if (_connectionCnt < currentConfig().maxSize && _breaker.tryBeginProbe()) {
+            LOG("断路器半开，探测后端");
+            reason = ResizeReason::Probe;
+            return true;
+        }
+        return false;
+    case BreakerState::HalfOpen:
+        return false;
+    }
+    return false;
+}
+
+// 新连接建立成功：先交付，再减少建立中计数，保证等待者不会被重复计算
+void ConnectionPool::connectionEstablished(Connection* p) {
+    bool recovered = _breaker.onSuccess();
+    resetConnectBackoff();
+
+    // 建连期间重新加载了配置、连接目标已变更：旧目标的连接不投入使用，退役并补充
+    if (p->generation() != _generation.load(memory_order_acquire)) {
+        _pendingConnects--;
+        retireConnection(p, ResizeReason::Reload);
+        return;
+    }
+    pushIdleConnection(p);
+    _pendingConnects--;
+    if (!_warm.load(memory_order_relaxed)) {
+        markWarm();
+    }
+    if (recovered) {
+        // 断开期间积压了补充需求，唤醒全部建连线程并发补齐
+        LOG("断路器闭合，后端已恢复");
+        lock_guard<mutex> lock(_queueMutex);
+        _produceCv.notify_all();
+    } else if (_waitingCnt > 0) {
+        notifyProducer();
+    }
+}
+
+// 新连接建立失败：归还名额并退避，退避结束后由建连线程按需重试；连续失败时断开断路器
+void ConnectionPool::connectionFailed() {
+    _pendingConnects--;
+    _connectionCnt--;
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        backOffConnects();
+    }
+    if (_breaker.onFailure()) {
+        onBreakerOpened();
+    }
+    notifyProducer();
+}
+
+/**
+ * @brief 断路器断开
+ * @details 1. 所有同步/批量等待者被唤醒，发现断路器断开后立即以BackendUnavailable失败
+ *          2. 异步等待者立即以空句柄完成
+ *          3. 在冷却结束时刻登记维护任务唤醒建连线程，由其中一个做半开探测
+ */
+void ConnectionPool::onBreakerOpened() {
+    BreakerStats st = _breaker.stats();
+    LOG("断路器断开: 连续建连失败" << st.consecutiveFailures << "次, 累计断开" << st.opens << "次");
+
+    abortWaiters();
+    scheduleMaintenance(_breaker.retryAt(), [this](TimerQueue::Clock::time_point) {
+        notifyProducer();
+        return TimerQueue::Clock::time_point::max();
+    });
+}
+
+
+// 让所有等待者失败：同步/批量等待者被唤醒后自行退出等待队列，异步等待者立即以空句柄完成
+void ConnectionPool::abortWaiters() {
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        for (Waiter* w : _waiters) {
+            if (!w->callback) {
+                w->cv.notify_one();
+            }
+        }
+        for (Waiter* w : _asyncWaiters) {
+            _waiters.erase(w);
+            _waitingCnt--;
+            _asyncReady.push_back(w);
+        }
+        _asyncWaiters.clear();
+        _asyncReadyCnt = (int)_asyncReady.size();
+    }
+    runAsyncCompletions();
+}
+
+/**
+ * @brief 隔离连接检查线程主函数
+ * @details 借出/归还校验未通过的连接不在业务线程上关闭，而是送入隔离区，
+ *          由本线程在锁外复查：
+ *          1. 复查通过(执行validation_query，未配置时mysql_ping)的连接重新投入使用
+ *          2. 复查失败的连接关闭(mysql_close可能涉及网络I/O)，并通知生产者补充
+ *          3. 超过max_lifetime而退役的连接直接关闭(其补充已由retireConnection请求)
+ * 
+ * @note 只在取出隔离列表时短暂持有_quarantineMutex，复查和关闭均不持有任何锁
+ */
+void ConnectionPool::checkerConnectionTask() {
+    for (;;) {
+        vector<Connection*> suspects;
+        vector<Connection*> retiring;
+        int shed = 0;
+        {
+            unique_lock<mutex> lock(_quarantineMutex);
+            _quarantineCv.wait(lock, [this] {
+                return !_running || !_quarantine.empty() || !_retiring.empty();
+            });
+            if (!_running) {
+                return;
+            }
+            suspects.swap(_quarantine);
+            retiring.swap(_retiring);
+            shed = _shedding.load();
+        }
+
+        bool destroyed = false;
+        for (Connection* p : retiring) {
+            destroyConnection(p);
+            destroyed = true;
+        }
+        if (shed > 0) {
+            // 本批包含此前所有被关闭的超额连接，销毁后才不再计入
+            lock_guard<mutex> lock(_quarantineMutex);
+            _shedding -= shed;
+        }
+        for (Connection* p : suspects) {
+            const string& query = currentConfig().validationQuery;
+            bool valid = query.empty() ? p->isValid() : p->validate(query);
+            if (valid) {
+                p->refreshAliveTime();
+                pushIdleConnection(p);
+            } else {
+                destroyConnection(p);
+                destroyed = true;
+            }
+        }
+        if (destroyed) {
+            notifyProducer();
+        }
+    }
+}
+
+
+/**
+ * @brief 维护线程主函数
+ * @details 连接池的所有后台维护工作都登记为_timers中的定时任务，由本线程统一驱动：
+ *          1. 睡到最早到期的维护任务与最早的异步等待者截止时间中较早者；
+ *             其他线程登记更早的任务或异步等待者时会提前唤醒本线程
+ *          2. 醒来后先处理超时的异步等待者，再执行所有到期的维护任务
+ *          3. 各任务自行计算下次执行时间(见scheduleMaintenanceTasks)
+ * 
+ * @note 同步等待者在各自的条件变量上按截止时间等待，不经过本线程
+ */
+void ConnectionPool::scannerConnectionTask() {
+    for (;;) {
+        {
+            unique_lock<mutex> lock(_queueMutex);
+            for (;;) {
+                if (!_running) {
+                    return;
+                }
+                _maintenanceDue = _timers.nextDeadline();
+                if (!_asyncWaiters.empty()) {
+                    _maintenanceDue = min(_maintenanceDue, (*_asyncWaiters.begin())->deadline);
+                }
+                if (chrono::steady_clock::now() >= _maintenanceDue) {
+                    break;
+                }
+                _maintenanceCv.wait_until(lock, _maintenanceDue);
+            }
+            _maintenanceDue = chrono::steady_clock::time_point::max();
+        }
+        expireAsyncWaiters();
+        _timers.runDue(chrono::steady_clock::now());
+    }
+}
+
+// 登记维护任务：比维护线程当前的唤醒时间更早时唤醒它
+void ConnectionPool::scheduleMaintenance(TimerQueue::Clock::time_point when, TimerQueue::Task task) {
+    _timers.schedule(when, move(task));
+    lock_guard<mutex> lock(_queueMutex);
+    if (when < _maintenanceDue) {
+        _maintenanceCv.notify_one();
+    }
+}
+
+/**
+ * @brief 登记连接池的周期性维护任务
+ * @details - 空闲回收：在下一个可能到期的时刻执行(见evictIdleConnections)
+ *          - 保活检测：keepalive_time大于0时，在下一个需要检测的时刻执行
+ *          - 存活时间：max_lifetime大于0时，在下一个空闲连接到期的时刻执行
+ *          - 线程缓存溢出：启用线程缓存时每thread_cache_idle_time执行
+ *          - 目标大小计算与缩容：每sizing_interval执行
+ *          - 配置重新加载信号：启用reload_on_sighup时每kReloadPollInterval检查一次
+ *          重新加载配置后由维护线程再次调用：各任务按新配置重新登记，
+ *          之前登记的任务在下次执行时发现纪元已变而不再执行
+ * @note 只在维护线程上调用(启动时在维护线程开始之前)，_lastSizingAt由维护线程独占
+ */
+void ConnectionPool::scheduleMaintenanceTasks() {
+    const PoolConfig& cfg = currentConfig();
+    auto now = TimerQueue::Clock::now();
+    uint64_t epoch = ++_maintenanceEpoch;
+    auto periodic = [this, epoch](TimerQueue::Task task) -> TimerQueue::Task {
+        return [this, epoch, task = move(task)](TimerQueue::Clock::time_point t) {
+            return epoch == _maintenanceEpoch ? task(t) : TimerQueue::Clock::time_point::max();
+        };
+    };
+
+    scheduleMaintenance(now + chrono::seconds(cfg.maxIdleTime),
+        periodic([this](TimerQueue::Clock::time_point t) { return evictIdleConnections(t); }));
+
+    if (cfg.keepaliveTime > 0) {
+        scheduleMaintenance(now + chrono::milliseconds(cfg.keepaliveTime),
+            periodic([this](TimerQueue::Clock::time_point t) { return keepAliveIdleConnections(t); }));
+    }
+
+    if (cfg.maxLifetime > 0) {
+        scheduleMaintenance(now + chrono::milliseconds(cfg.maxLifetime),
+            periodic([this](TimerQueue::Clock::time_point t) { return retireExpiredConnections(t); }));
+    }
+
+    // 线程缓存中闲置过久的连接溢出回全局队列
+    if (_threadCacheEnabled) {
+        scheduleMaintenance(now + chrono::milliseconds(cfg.threadCacheIdleTime),
+            periodic([this](TimerQueue::Clock::time_point t) {
+                if (spillThreadCaches(false) > 0) {
+                    wakeWaiters();
+                }
+                return t + chrono::milliseconds(currentConfig().threadCacheIdleTime);
+            }));
+    }
+
+    // 更新目标大小，连接数持续超出目标时缩容
+    _lastSizingAt = now;
+    scheduleMaintenance(now + chrono::milliseconds(_sizingInterval),
+        periodic([this](TimerQueue::Clock::time_point t) {
+            if (adjustPoolSize(t)) {
+                wakeWaiters();
+                notifyProducer();
+            }
+            return t + chrono::milliseconds(_sizingInterval);
+        }));
+
+    // 信号处理函数只能递增计数，由维护线程发现计数变化后重新加载
+    if (cfg.reloadOnSighup) {
+        scheduleMaintenance(now + kReloadPollInterval,
+            periodic([this](TimerQueue::Clock::time_point t) {
+                int signals = s_reloadSignals.load();
+                if (signals != _reloadSignalsSeen) {
+                    _reloadSignalsSeen = signals;
+                    LOG("收到SIGHUP，重新加载配置");
+                    reload();
+                }
+                return t + kReloadPollInterval;
+            }));
+    }
+}
+
+/**
+ * @brief 回收空闲超时的连接
+ * @details 1. 逐个分片检查全部空闲连接(LIFO整栈检查，FIFO环形队列轮转一遍，
+ *             见IdleStore::evictCold)，回收空闲超过max_idle_time的连接
+ *          2. 只回收超出下限的部分：下限为目标大小(不低于_initSize)，
+ *             且借出的连接之外至少保留min_idle个空闲连接
+ *          3. 检查时记录留下的连接中最长的空闲时长，据此计算下次执行时间，
+ *             回收延迟不超过定时精度(此前按max_idle_time周期扫描，最多延迟一倍)
+ *          4. 销毁连接时不持有任何锁
+ * 
+ * @note 之后归还或新建的连接空闲得更晚，不会早于算出的下次执行时间到期；
+ *       受下限保护而未回收时，按max_idle_time后再检查
+ */
+TimerQueue::Clock::time_point ConnectionPool::evictIdleConnections(TimerQueue::Clock::time_point now) {
+    const int64_t limit = currentConfig().maxIdleTime * 1000;
+    int64_t longest = 0;    // 留下的连接中最长的空闲时长(毫秒)
+    bool limited = false;   // 是否有连接因下限而未检查或未回收
+    auto expired = [&](Connection* p) {
+        int64_t idle = p->getAliveeTime();
+        if (idle >= limit) {
+            return true;
+        }
+        longest = max(longest, idle);
+        return false;
+    };
+
+    bool reclaimed = false;
+    for (auto& shard : _shards) {
+        int inUse = _connectionCnt - (int)idleCount();
+        int surplus = _connectionCnt - max(_targetSize.load(), inUse + currentConfig().minIdle);
+        if (surplus <= 0) {
+            limited = true;
+            break;
+        }
+
+        vector<Connection*> victims;
+        if (shard->idle.evictCold(expired, surplus, victims) == (size_t)surplus) {
+            limited = true;
+        }
+        for (Connection* p : victims) {
+            destroyConnection(p);  // 实际销毁连接（可能耗时，不持有任何锁）
+            reclaimed = true;
+        }
+        if (!victims.empty()) {
+            recordResize(ResizeReason::IdleTimeout, victims.size());
+        }
+    }
+
+    // FIFO轮转期间可能有借用方进入等待，连接数减少时还需通知生产者
+    wakeWaiters();
+    if (reclaimed) {
+        notifyProducer();
+    }
+    return now + chrono::milliseconds(limited ? limit : limit - longest);
+}
+
+/**
+ * @brief 退役超过max_lifetime的空闲连接
+ * @details 1. 逐个分片取出已到期的空闲连接，在本线程关闭(不占用业务线程)，
+ *             并请求建连线程补充同样数量的新连接
+ *          2. 借出中的连接在归还时检查，两次执行之间到期的空闲连接和线程缓存中的连接在借出时检查，
+ *             到期的都由retireConnection退役
+ *          3. 记录留下的连接中最早的到期时刻作为下次执行时间；
+ *             没有空闲连接时，之后建立的连接最早在max_lifetime × (1 - jitter)后到期
+ * 
+ * @note 每个连接的存活时间带随机提前量(见ConnectionFactory::lifetime)，
+ *       同时建立的连接会在一个时间窗口内陆续退役，补充的建连也随之分散
+ */
+TimerQueue::Clock::time_point ConnectionPool::retireExpiredConnections(TimerQueue::Clock::time_point now) {
+    PoolClock::time_point clockNow = PoolClock::now();
+    PoolClock::time_point earliest = PoolClock::time_point::max();  // 留下的连接中最早的到期时刻
+    auto expired = [&](Connection* p) {
+        if (p->expiresAt() <= clockNow) {
+            return true;
+        }
+        earliest = min(earliest, p->expiresAt());
+        return false;
+    };
+
+    int retired = 0;
+    for (auto& shard : _shards) {
+        vector<Connection*> victims;
+        shard->idle.evictCold(expired, currentConfig().maxSize, victims);
+        for (Connection* p : victims) {
+            destroyConnection(p);
+        }
+        retired += (int)victims.size();
+    }
+    if (retired > 0) {
+        recordResize(ResizeReason::Lifetime, retired);
+        _replacements += retired;
+        notifyProducer();
+        LOG("退役超过最长存活时间的空闲连接: " << retired << "个");
+    }
+
+    // 取出期间可能有借用方进入等待
+    wakeWaiters();
+    if (earliest == PoolClock::time_point::max()) {
+        const PoolConfig& cfg = currentConfig();
+        return now + chrono::milliseconds((int64_t)cfg.maxLifetime * (100 - cfg.lifetimeJitter) / 100);
+    }
+    return now + chrono::duration_cast<chrono::milliseconds>(earliest - clockNow) + chrono::milliseconds(1);
+}
+
+// 重新加载后连接总数超过新max_size时，关闭多余的空闲连接(借出中的在归还时关闭)
+void ConnectionPool::trimToMaxSize() {
+    int trimmed = 0;
+    for (auto& shard : _shards) {
+        int excess = _connectionCnt - _shedding - currentConfig().maxSize;
+        if (excess <= 0) {
+            break;
+        }
+        vector<Connection*> victims;
+        shard->idle.evictCold([](Connection*) { return true; }, excess, victims);
+        for (Connection* p : victims) {
+            destroyConnection(p);
+        }
+        trimmed += (int)victims.size();
+    }
+    if (trimmed > 0) {
+        recordResize(ResizeReason::Reload, trimmed);
+        LOG("关闭超出新max_size的空闲连接: " << trimmed << "个");
+    }
+    wakeWaiters();
+}
+
+// 连接目标变更后退役旧目标的空闲连接(含线程缓存中的)，并请求补充同样数量的新连接
+void ConnectionPool::retireStaleConnections() {
+    spillThreadCaches(true);
+
+    const uint64_t generation = _generation.load(memory_order_acquire);
+    auto stale = [generation](Connection* p) { return p->generation() != generation; };
+    int retired = 0;
+    for (auto& shard : _shards) {
+        vector<Connection*> victims;
+        shard->idle.evictCold(stale, currentConfig().maxSize, victims);
+        for (Connection* p : victims) {
+            destroyConnection(p);
+        }
+        retired += (int)victims.size();
+    }
+    if (retired > 0) {
+        recordResize(ResizeReason::Reload, retired);
+        _replacements += retired;
+        notifyProducer();
+        LOG("退役连接目标变更前建立的空闲连接: " << retired << "个");
+    }
+    wakeWaiters();
+}
+
+/**
+ * @brief 空闲连接保活检测
+ * @details 1. 逐个分片每批取出至多kKeepaliveBatch个超过keepalive_time未使用也未检测的空闲连接，
+ *             同一时刻只有一小批连接不可借出
+ *          2. 在锁外逐个检测(执行validation_query，未配置时mysql_ping)：
+ *             有效的立即放回，只更新检测时间，空闲回收仍按最后使用时间计算；
+ *             此时有等待者则直接交给等待者，否则放回原分片冷端；
+ *             失效的关闭并通知生产者补充
+ *          3. 有借用方在等待时不再取出新的一批，剩余连接在kKeepaliveRetryDelay后再检测，
+ *             避免检测占用连接而让等待者触发多余的建连
+ *          4. 记录留下的连接中最久未检测的时长，据此计算下次执行时间
+ * 
+ * @note 用于在服务端wait_timeout或中间设备断开空闲连接之前保持连接活跃，
+ *       keepalive_time应小于这些超时
+ */
+TimerQueue::Clock::time_point ConnectionPool::keepAliveIdleConnections(TimerQueue::Clock::time_point now) {
+    const chrono::milliseconds interval(currentConfig().keepaliveTime);
+    chrono::milliseconds longest(0);  // 留下的连接中最久未检测的时长
+    auto due = [&](Connection* p) {
+        chrono::milliseconds since = p->checkedFor();
+        if (since >= interval) {
+            return true;
+        }
+        longest = max(longest, since);
+        return false;
+    };
+
+    bool destroyed = false;
+    bool deferred = false;  // 是否因有等待者而留下了未检测的连接
+    for (auto& shard : _shards) {
+        for (;;) {
+            if (_waitingCnt.load() > 0) {
+                deferred = true;
+                break;
+            }
+            vector<Connection*> checked;
+            if (shard->idle.evictCold(due, kKeepaliveBatch, checked) == 0) {
+                break;
+            }
+
+            // 逆序放回冷端，保持原有的冷热顺序
+            for (auto it = checked.rbegin(); it != checked.rend(); ++it) {
+                Connection* p = *it;
+                const string& query = currentConfig().validationQuery;
+                bool valid = query.empty() ? p->isValid() : p->validate(query);
+                if (!valid) {
+                    destroyConnection(p);
+                    destroyed = true;
+                    continue;
+                }
+
+                p->markChecked();  // 放回后可能立即被借出，必须在放回之前更新
+                if (_waitingCnt.load() > 0) {
+                    pushIdleConnection(p);  // 检测期间进入等待的借用方直接取用
+                } else if (!shard->idle.pushCold(p)) {
+                    destroyConnection(p);
+                    destroyed = true;
+                }
+            }
+        }
+        if (deferred) {
+            break;
+        }
+    }
+
+    // 检测期间可能有借用方进入等待
+    wakeWaiters();
+    if (destroyed) {
+        notifyProducer();
+    }
+    chrono::milliseconds next = interval - longest;
+    if (deferred) {
+        next = min(next, kKeepaliveRetryDelay);
+    }
+    return now + next;
+}
+
+
+
+
+
+
+/**
+ * @brief 计算目标大小并按需缩容(维护线程每个sizing_interval调用一次)
+ * @details 1. 启用auto_size时按Little定律估算所需连接数：
+ *             L = λ(借用到达率) × W(平均占用时长)，乘以余量系数后向上取整，
+ *             λ和W均做指数平滑；目标大小限制在[initial_size, max_size]内
+ *          2. 连接数低于目标时通知生产者补充
+ *          3. 期望大小 = max(目标大小, 本周期借出数峰值 + min_idle)；
+ *             连接数超出期望大小的状态持续shrink_delay后，从冷端回收窗口内
+ *             始终多余的空闲连接，状态中断则重新计时(滞回，避免负载抖动时反复建连/断连)
+ * @note 未启用auto_size时目标大小固定为initial_size，且不做Surplus缩容，
+ *       多余连接只按max_idle_time回收
+ */
+bool ConnectionPool::adjustPoolSize(chrono::steady_clock::time_point now) {
+    const PoolConfig& cfg = currentConfig();
+    int target = cfg.initSize;
+    if (_autoSize) {
+        uint64_t borrows = 0;
+        for (int i = 0; i < kPriorityCount; ++i) {
+            borrows += _priorityStats[i].borrows.load(memory_order_relaxed);
+        }
+        double seconds = chrono::duration<double>(now - _lastSizingAt).count();
+        uint64_t holdNs = _holdNsTotal.exchange(0);
+        uint64_t samples = _holdSamples.exchange(0);
+        if (seconds > 0) {
+            double rate = (borrows - _lastBorrowTotal) / seconds;
+            _arrivalRate = _arrivalRate + kSizingSmoothing * (rate - _arrivalRate);
+        }
+        if (samples > 0) {
+            double holdMs = holdNs / 1e6 / samples;
+            _avgHoldMs = _avgHoldMs + kSizingSmoothing * (holdMs - _avgHoldMs);
+        }
+        _lastBorrowTotal = borrows;
+        _lastSizingAt = now;
+
+        double concurrency = _arrivalRate * _avgHoldMs / 1000.0;
+        target = max(target, (int)ceil(concurrency * kAutoSizeHeadroom));
+    }
+    target = min(target, cfg.maxSize);
+    int previous = _targetSize.exchange(target);
+    if (target > previous && _connectionCnt < target) {
+        notifyProducer();
+    }
+    if (!_autoSize) {
+        return false;
+    }
+
+    // 借出数按本周期峰值计算，避免采样恰好落在负载低谷时误判为多余
+    int peak = _inUsePeak.exchange(_inUse.load(memory_order_relaxed));
+    int idle = (int)idleCount();
+    int desired = max(target, peak + cfg.minIdle);
+    int surplus = min(_connectionCnt - desired, idle - cfg.minIdle);
+    if (surplus <= 0) {
+        _surplusSince = chrono::steady_clock::time_point();
+        return false;
+    }
+    if (_surplusSince == chrono::steady_clock::time_point()) {
+        _surplusSince = now;
+        _surplusMin = surplus;
+    }
+    _surplusMin = min(_surplusMin, surplus);
+    if (now - _surplusSince < chrono::milliseconds(cfg.shrinkDelay)) {
+        return false;
+    }
+
+    // 只回收整个观察窗口内始终多余的部分(即按窗口内的峰值需求保留)，之后重新计时
+    surplus = _surplusMin;
+    _surplusSince = chrono::steady_clock::time_point();
+    int reclaimed = 0;
+    auto any = [](Connection*) { return true; };
+    for (auto& shard : _shards) {
+        if (reclaimed >= surplus) {
+            break;
+        }
+        vector<Connection*> victims;
+        shard->idle.evictCold(any, surplus - reclaimed, victims);
+        for (Connection* p : victims) {
+            destroyConnection(p);
+        }
+        reclaimed += (int)victims.size();
+    }
+    if (reclaimed > 0) {
+        recordResize(ResizeReason::Surplus, reclaimed);
+        LOG("连接池缩容: 回收" << reclaimed << "个连接, 目标=" << target);
+    }
+    return reclaimed > 0;
+}
+
+/**
+ * @brief 析构函数
+ * @details 1. 停止并等待本连接池的后台线程退出
+ *          2. 尚未完成的异步请求以空句柄回调
+ *          3. 关闭所有空闲、线程缓存和隔离区中的连接
+ * @warning 析构前所有借出的连接都应已归还
+ */
+ConnectionPool::~ConnectionPool() {
+    shutdown(chrono::steady_clock::now());
+    // 截止时间内未退出的后台线程(如仍在握手的建连线程)在这里等待其结束，再关闭它们留下的连接
+    if (_joiner.joinable()) {
+        _joiner.join();
+    }
+    closeIdleConnections();
+}
+
+// 在超时时间内优雅关闭连接池
+bool ConnectionPool::shutdown(chrono::milliseconds timeout) {
+    return shutdown(chrono::steady_clock::now() + timeout);
+}
+
+/**
+ * @brief 优雅关闭连接池
+ * @details 1. 置_closing拒绝新的借用，置_running=false通知所有后台线程退出，
+ *             并让所有等待中的借用方立即失败；此后不再发起新的握手
+ *          2. 等待借出的连接归还直到截止时间：归还方看到_closing后直接关闭并通知；
+ *             未借出的连接并行关闭，后台线程在退出前放回的连接由每次醒来时的补扫关闭
+ *          3. 由_joiner线程回收后台线程，这里只等到截止时间：正在进行的握手不可中断，
+ *             截止时间后完成的连接由建连线程自己关闭，线程本身由析构函数回收
+ */
+bool ConnectionPool::shutdown(chrono::steady_clock::time_point deadline) {
+    lock_guard<mutex> guard(_shutdownMutex);
+    if (!_closing.exchange(true)) {
+        LOG("连接池开始关闭");
+    }
+
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        _running = false;
+        _produceCv.notify_all();
+        _maintenanceCv.notify_all();
+    }
+    {
+        lock_guard<mutex> lock(_quarantineMutex);
+        _quarantineCv.notify_all();
+    }
+    abortWaiters();
+    {
+        lock_guard<mutex> lock(_reloadMutex);
+        setReloadSignal(false);
+    }
+    // 只在第一次调用时启动；_joiner未启动或已回收时没有其他线程写_threadsJoined
+    if (!_joiner.joinable() && !_threadsJoined) {
+        _joiner = thread(&ConnectionPool::joinBackgroundThreads, this);
+    }
+    closeIdleConnections();
+
+    // 建立中的连接也计入_connectionCnt，握手完成后由建连线程关闭并通知
+    unique_lock<mutex> lock(_queueMutex);
+    while (_connectionCnt > 0 || !_threadsJoined) {
+        auto now = chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        _drainCv.wait_until(lock, min(deadline, now + chrono::milliseconds(10)));
+        lock.unlock();
+        closeIdleConnections();
+        lock.lock();
+    }
+
+    int outstanding = _connectionCnt;
+    bool joined = _threadsJoined;
+    lock.unlock();
+    if (joined && _joiner.joinable()) {
+        _joiner.join();
+    }
+    if (outstanding > 0) {
+        LOG("连接池关闭: 截止时间已到，仍有" << outstanding << "个连接未归还或仍在建立");
+    } else if (!joined) {
+        LOG("连接池关闭: 截止时间已到，后台线程尚未退出");
+    }
+    return outstanding == 0 && joined && chrono::steady_clock::now() <= deadline;
+}
+
+// 回收所有后台线程，完成后通知shutdown()
+void ConnectionPool::joinBackgroundThreads() {
+    if (_warmup.joinable()) {
+        _warmup.join();
+    }
+    if (_factory) {
+        _factory->join();
+    }
+    for (thread* t : {&_scanner, &_checker}) {
+        if (t->joinable()) {
+            t->join();
+        }
+    }
+    lock_guard<mutex> lock(_queueMutex);
+    _threadsJoined = true;
+    _drainCv.notify_all();
+}
+
+// 取出所有未借出的连接并行关闭：mysql_close会向服务端发送COM_QUIT，逐个关闭时耗时随连接数累加
+size_t ConnectionPool::closeIdleConnections() {
+    vector<Connection*> conns;
+    if (!_shards.empty()) {
+        spillThreadCaches(true);
+        Connection* p = nullptr;
+        while (popIdleConnection(p)) {
+            conns.push_back(p);
+        }
+    }
+    {
+        lock_guard<mutex> lock(_quarantineMutex);
+        conns.insert(conns.end(), _quarantine.begin(), _quarantine.end());
+        conns.insert(conns.end(), _retiring.begin(), _retiring.end());
+        _quarantine.clear();
+        _retiring.clear();
+        _shedding = 0;
+    }
+
+    atomic<size_t> next(0);
+    auto task = [this, &conns, &next] {
+        for (size_t i = next++; i < conns.size(); i = next++) {
+            destroyConnection(conns[i]);
+        }
+    };
+    // 与预热使用相同的并发度，当前线程也参与关闭
+    size_t workers = min(conns.size(), (size_t)max(1, _warmupConcurrency));
+    vector<thread> threads;
+    for (size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(task);
+    }
+    task();
+    for (thread& t : threads) {
+        t.join();
+    }
+    return conns.size();
+}
+
+
+// 打印线程池信息
+void ConnectionPool::printStats() const {
+    size_t cached = 0;
+    {
+        lock_guard<mutex> lock(_cacheMutex);
+        for (const auto& slot : _cacheSlots) {
+            cached += slot->conn.load(memory_order_relaxed) != nullptr;
+        }
+    }
+    size_t quarantined = 0;
+    {
+        lock_guard<mutex> lock(_quarantineMutex);
+        quarantined = _quarantine.size();
+    }
+    cout << "连接池状态: " 
+         << "总数=" << _connectionCnt 
+         << ", 空闲=" << idleCount()
+         << ", 线程缓存=" << cached
+         << ", 隔离=" << quarantined
+         << ", 等待=" << _waitingCnt
+         << ", 建连中=" << (_factory ? _factory->connecting() : 0)
+         << ", 建连失败=" << (_factory ? _factory->failures() : 0)
+         << endl;
+
+    // 各优先级的等待统计
+    static const char* kPriorityNames[kPriorityCount] = {"interactive", "normal", "batch"};
+    for (int i = 0; i < kPriorityCount; ++i) {
+        PriorityStats st = getPriorityStats(static_cast<BorrowPriority>(i));
+        if (st.borrows == 0) {
+            continue;
+        }
+        cout << "  [" << kPriorityNames[i] << "] 借用=" << st.borrows
+             << ", 预留=" << st.reserved
+             << ", 等待=" << st.waits
+             << ", 超时=" << st.timeouts
+             << ", 拒绝=" << st.rejected
+             << ", 平均等待=" << (st.waits ? st.totalWaitUs / st.waits : 0) << "us"
+             << ", 最长等待=" << st.maxWaitUs << "us"
+             << endl;
+    }
+
+    // 断路器
+    BreakerStats breaker = getBreakerStats();
+    cout << "  [breaker] 状态=" << breakerStateName(breaker.state)
+         << ", 连续失败=" << breaker.consecutiveFailures
+         << ", 断开次数=" << breaker.opens
+         << ", 拒绝=" << breaker.rejected
+         << endl;
+
+    // 建连退避与限速
+    {
+        lock_guard<mutex> lock(_queueMutex);
+        auto now = chrono::steady_clock::now();
+        int64_t backoffMs = _connectNotBefore > now
+            ? chrono::duration_cast<chrono::milliseconds>(_connectNotBefore - now).count() : 0;
+        cout << "  [connect] 连续失败=" << _connectFailStreak
+             << ", 退避剩余=" << backoffMs << "ms";
+        if (!_connectBucket.unlimited()) {
+            cout << ", 令牌=" << _connectBucket.tokens(now);
+        }
+        cout << endl;
+    }
+
+    // 大小决策：目标大小、Little定律输入和各原因的扩缩容连接数
+    SizingStats sizing = getSizingStats();
+    cout << "  [sizing] 目标=" << sizing.target
+         << ", 最小空闲=" << sizing.minIdle;
+    if (sizing.autoSize) {
+        cout << ", 到达率=" << sizing.arrivalRate << "/s"
+             << ", 平均占用=" << sizing.avgHoldMs << "ms";
+    }
+    for (int i = 0; i < kResizeReasonCount; ++i) {
+        cout << ", " << resizeReasonName(static_cast<ResizeReason>(i)) << "=" << sizing.resizes[i];
+    }
+    cout << endl;
+
+    // 分片模式下输出各分片空闲连接数，便于观察分片间是否失衡
+    if (_shards.size() > 1) {
+        cout << "分片空闲: [";
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            cout << (i ? ", " : "") << _shards[i]->idle.size();
+        }
+        cout << "]" << endl;
+    }
+}
+
+
+// ConnectionGroup：批量借出的连接组，析构时全部归还
+ConnectionGroup::ConnectionGroup(ConnectionPool* pool, vector<Connection*> conns, BorrowPriority prio)
+    : _pool(pool)
+    , _conns(move(conns))
+    , _prio(prio)
+{
+}
+
+ConnectionGroup::ConnectionGroup(ConnectionGroup&& other) noexcept
+    : _pool(other._pool)
+    , _conns(move(other._conns))
+    , _prio(other._prio)
+{
+    other._conns.clear();
+}
+
+ConnectionGroup& ConnectionGroup::operator=(ConnectionGroup&& other) noexcept {
+    if (this != &other) {
+        reset();
+        _pool = other._pool;
+        _conns = move(other._conns);
+        _prio = other._prio;
+        other._conns.clear();
+    }
+    return *this;
+}
+
+ConnectionGroup::~ConnectionGroup() {
+    reset();
+}
+
+void ConnectionGroup::reset() {
+    for (Connection* p : _conns) {
+        _pool->releaseConnection(p, _prio);
+    }
+    _conns.clear();
+}
+
+// PooledConnection：借出连接的RAII句柄，析构时归还
+PooledConnection::PooledConnection(PooledConnection&& other) noexcept
+    : _pool(other._pool)
+    , _conn(other._conn)
+    , _prio(other._prio)
+{
+    other._pool = nullptr;
+    other._conn = nullptr;
+}
+
+PooledConnection& PooledConnection::operator=(PooledConnection&& other) noexcept {
+    if (this != &other) {
+        reset();
+        _pool = other._pool;
+        _conn = other._conn;
+        _prio = other._prio;
+        other._pool = nullptr;
+        other._conn = nullptr;
+    }
+    return *this;
+}
+
+void PooledConnection::reset() {
+    if (_conn != nullptr) {
+        _pool->releaseConnection(_conn, _prio);
+        _conn = nullptr;
+        _pool = nullptr;
+    }
+}
+
+Connection* PooledConnection::release() {
+    Connection* p = _conn;
+    _conn = nullptr;
+    _pool = nullptr;
+    return p;
+}
+
+#if __cplusplus >= 202002L
+// AcquireAwaitable：快速路径失败后登记异步等待者，不再走一遍快速路径，也不重复计入借用次数
+bool AcquireAwaitable::await_suspend(coroutine_handle<> h) {
+    ConnectionPool::Waiter* w = new ConnectionPool::Waiter;
+    w->prio = _prio;
+    w->deadline = chrono::steady_clock::now() + _timeout;
+    w->callback = [this, h](PooledConnection conn) {
+        _conn = move(conn);
+        if (_settled.exchange(true)) {
+            h.resume();
+        }
+    };
+    _pool->submitAsyncWaiter(w);
+    return !_settled.exchange(true);
+}
+#endif
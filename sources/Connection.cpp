@@ -9,6 +9,8 @@
 
 #include "Connection.h"
 #include "public.h"
+#include <errmsg.h>
+#include <mysqld_error.h>
 #include <stdexcept>
 #include <cstring>
 #include <iostream>
@@ -39,13 +41,13 @@ using namespace std;
  * 
  * @par 初始化流程：
  * @code
- * 1. 初始化成员变量(_conn=nullptr, _alivetime=0)
+ * 1. 初始化成员变量(_conn=nullptr, _alivetime=当前时间)
  * 2. 调用mysql_init创建连接对象
  * 3. 设置自动重连选项
  * 4. 设置连接超时选项
  * @endcode
  */
-Connection::Connection() : _conn(nullptr), _alivetime(0) {
+Connection::Connection() : _conn(nullptr), _alivetime(PoolClock::now()) {
     // 初始化MySQL连接对象
     _conn = mysql_init(nullptr);
     if (!_conn) {
@@ -92,9 +94,12 @@ Connection::Connection() : _conn(nullptr), _alivetime(0) {
  */
 Connection::~Connection() {
     if (_conn) {
-        // 记录连接存活时间（秒级精度）
+        // 记录连接空闲时间（秒级精度）
         LOG("Releasing connection (alive time: " 
-           << (clock() - _alivetime)/CLOCKS_PER_SEC << "s)");
+           << getAliveeTime() / 1000 << "s)");
+
+        // 先关闭缓存的预处理语句(同时释放服务端资源)
+        trimStatements(0);
         
         // 安全关闭MySQL连接
         mysql_close(_conn);
@@ -150,8 +155,9 @@ bool Connection::connect(string ip, unsigned short port,
                        unsigned int connect_timeout) {
     LOG("Connecting to " << ip << ":" << port << "...");
     
-    // 清理现有连接(如果存在)
+    // 清理现有连接(如果存在)，缓存的语句属于旧连接，一并关闭
     if (_conn) {
+        trimStatements(0);
         mysql_close(_conn);
         _conn = mysql_init(nullptr);
         if (!_conn) {
@@ -326,3 +332,159 @@ MYSQL_RES* Connection::query(string sql) {
 bool Connection::isValid() const {
     return _conn && 0 == mysql_ping(_conn);  // 更可靠的检查方式
 }
+
+
+/**
+ * @brief 执行校验SQL检查连接是否存活
+ * @details 与isValid()的mysql_ping相比，能发现权限、只读等服务端状态问题
+ * 
+ * @note 关键实现细节：
+ * - 使用mysql_real_query执行校验SQL
+ * - 读取并释放全部结果集(兼容CLIENT_MULTI_STATEMENTS)，避免连接残留未读结果
+ * 
+ * @param[in] sql 校验SQL
+ * @return bool 执行成功返回true，失败返回false
+ */
+bool Connection::validate(const string& sql) {
+    if (!_conn || mysql_real_query(_conn, sql.c_str(), sql.size())) {
+        return false;
+    }
+
+    int status = 0;
+    do {
+        MYSQL_RES* result = mysql_store_result(_conn);
+        if (result) {
+            mysql_free_result(result);
+        } else if (mysql_field_count(_conn) > 0) {
+            return false;
+        }
+    } while ((status = mysql_next_result(_conn)) == 0);
+
+    return status == -1;
+}
+
+
+/**
+ * @brief 获取SQL对应的预处理语句
+ * @details 按SQL文本查找本连接的语句缓存(LRU)：
+ * 1. 命中时把语句移到最近使用端后直接返回，不产生网络往返
+ * 2. 未命中时mysql_stmt_init + mysql_stmt_prepare，成功后放入最近使用端
+ * 3. 缓存超出容量时mysql_stmt_close最久未使用的语句，服务端同时释放该语句
+ *
+ * @note 关键实现细节：
+ * - 缓存属于Connection对象，连接在连接池中借出、归还时语句保持不变，
+ *   只在连接关闭、重新连接或被淘汰时关闭
+ * - 预处理失败的语句不进入缓存
+ *
+ * @warning 注意事项：
+ * - 非线程安全，与连接的其他操作一样只能由借用方使用
+ * - 调用者不得关闭返回的语句
+ *
+ * @param[in] sql 使用?占位符的SQL语句
+ * @return MYSQL_STMT* 预处理语句，失败返回nullptr
+ */
+MYSQL_STMT* Connection::prepare(const string& sql) {
+    if (!_conn) {
+        LOG("Prepare attempted on null connection");
+        throw std::runtime_error("Null connection in prepare");
+    }
+
+    auto it = _stmtIndex.find(sql);
+    if (it != _stmtIndex.end()) {
+        _stmtLru.splice(_stmtLru.begin(), _stmtLru, it->second);
+        return it->second->second;
+    }
+
+    MYSQL_STMT* stmt = mysql_stmt_init(_conn);
+    if (!stmt) {
+        LOG("Statement init failed: " << mysql_error(_conn));
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, sql.c_str(), sql.size())) {
+        LOG("Prepare failed: " << mysql_stmt_error(stmt) << "\nSQL: "
+           << sql.substr(0, 200) << (sql.length() > 200 ? "..." : ""));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+
+    _stmtLru.emplace_front(sql, stmt);
+    _stmtIndex[sql] = _stmtLru.begin();
+    trimStatements(_stmtCapacity);
+    return stmt;
+}
+
+
+// 语句句柄是否已失效：连接断开(含自动重连)后服务端已释放该语句，或语句未处于已预处理状态
+static bool isStatementLost(unsigned int err) {
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST
+        || err == ER_UNKNOWN_STMT_HANDLER || err == CR_NO_PREPARE_STMT;
+}
+
+
+/**
+ * @brief 以预处理语句方式执行SQL
+ * @details 1. 通过prepare()取得缓存的语句
+ *          2. 绑定参数并执行
+ *          3. 只有语句句柄失效(连接断开、自动重连或服务端重启后)时才移除并关闭该语句，
+ *             下次调用重新预处理即可恢复；主键冲突、死锁等普通执行错误保留缓存
+ *
+ * @note 不自动重试，避免非幂等的写操作被重复执行
+ *
+ * @param[in] sql 使用?占位符的SQL语句
+ * @param[in] params 参数绑定数组，没有参数时传nullptr
+ * @return MYSQL_STMT* 执行后的语句，失败返回nullptr
+ */
+MYSQL_STMT* Connection::execute(const string& sql, MYSQL_BIND* params) {
+    MYSQL_STMT* stmt = prepare(sql);
+    if (!stmt) {
+        return nullptr;
+    }
+
+    if (mysql_stmt_param_count(stmt) > 0) {
+        if (!params) {
+            LOG("Execute failed: missing parameters\nSQL: " << sql.substr(0, 200));
+            return nullptr;
+        }
+        if (mysql_stmt_bind_param(stmt, params)) {
+            LOG("Bind failed: " << mysql_stmt_error(stmt) << "\nSQL: " << sql.substr(0, 200));
+            return nullptr;
+        }
+    }
+
+    if (mysql_stmt_execute(stmt)) {
+        LOG("Execute failed: " << mysql_stmt_error(stmt) << "\nSQL: "
+           << sql.substr(0, 200) << (sql.length() > 200 ? "..." : ""));
+        if (isStatementLost(mysql_stmt_errno(stmt))) {
+            evictStatement(sql);
+        }
+        return nullptr;
+    }
+    return stmt;
+}
+
+
+void Connection::setStatementCacheSize(size_t capacity) {
+    _stmtCapacity = capacity;
+    trimStatements(capacity);
+}
+
+
+// 从最久未使用端开始关闭语句(mysql_stmt_close同时通知服务端释放)
+void Connection::trimStatements(size_t capacity) {
+    while (_stmtLru.size() > capacity) {
+        mysql_stmt_close(_stmtLru.back().second);
+        _stmtIndex.erase(_stmtLru.back().first);
+        _stmtLru.pop_back();
+    }
+}
+
+
+void Connection::evictStatement(const string& sql) {
+    auto it = _stmtIndex.find(sql);
+    if (it == _stmtIndex.end()) {
+        return;
+    }
+    mysql_stmt_close(it->second->second);
+    _stmtLru.erase(it->second);
+    _stmtIndex.erase(it);
+}
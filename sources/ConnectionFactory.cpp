@@ -0,0 +1,124 @@
+#include "ConnectionFactory.h"
+#include "public.h"
+#include <iostream>
+#include <random>
+
+ConnectionFactory::ConnectionFactory(ConnectionSlab& slab, const PoolConfig& config)
+    : _slab(slab)
+    , _config(&config)
+    , _generation(0)
+    , _connecting(0)
+    , _failures(0)
+{
+}
+
+ConnectionFactory::~ConnectionFactory() {
+    join();
+}
+
+// 先发布快照再发布版本：读到新版本的create()一定能读到新快照
+void ConnectionFactory::setConfig(const PoolConfig& config, uint64_t generation) {
+    _config.store(&config, memory_order_release);
+    _generation.store(generation, memory_order_release);
+}
+
+// 建立一个连接：构造失败或握手失败时回收槽位并返回nullptr
+Connection* ConnectionFactory::create() {
+    // 先读版本再读快照：读到旧版本时连接最多被多退役一次，不会把旧目标的连接标成新版本
+    uint64_t generation = _generation.load(memory_order_acquire);
+    const PoolConfig& config = *_config.load(memory_order_acquire);
+    Connection* p = nullptr;
+    _connecting++;
+    try {
+        p = _slab.allocate();
+        if (!p->connect(config.ip, config.port, config.username, config.password, config.dbname)) {
+            throw runtime_error("connect returned false");
+        }
+        p->refreshAliveTime();
+        p->setGeneration(generation);
+        p->setStatementCacheSize(config.stmtCacheSize);
+        if (config.maxLifetime > 0) {
+            p->setLifetime(lifetime(config));
+        }
+    } catch (const exception& e) {
+        LOG("创建连接异常: " << e.what());
+        _slab.deallocate(p);
+        p = nullptr;
+        _failures++;
+    }
+    _connecting--;
+    return p;
+}
+
+// 存活时间在[max_lifetime × (1 - jitter), max_lifetime]内均匀分布
+chrono::milliseconds ConnectionFactory::lifetime(const PoolConfig& config) {
+    static thread_local mt19937 rng(random_device{}());
+    int spread = (int)((int64_t)config.maxLifetime * config.lifetimeJitter / 100);
+    uniform_int_distribution<int> dist(0, spread);
+    return chrono::milliseconds(config.maxLifetime - dist(rng));
+}
+
+// 启动min(concurrency, count)个临时线程，共同领取count个建连任务
+int ConnectionFactory::createMany(int count, int concurrency,
+                                  const function<bool()>& reserve,
+                                  const function<void(Connection*)>& publish,
+                                  const function<void()>& cancel) {
+    atomic_int remaining(count);
+    atomic_int created(0);
+    auto task = [&] {
+        while (remaining.fetch_sub(1) > 0) {
+            if (!reserve()) {
+                return;
+            }
+            Connection* p = create();
+            if (p != nullptr) {
+                publish(p);
+                created++;
+            } else {
+                cancel();
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < min(max(1, concurrency), count); ++i) {
+        threads.emplace_back(task);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    return created.load();
+}
+
+void ConnectionFactory::start(int workers,
+                              function<bool()> reserve,
+                              function<void(Connection*)> publish,
+                              function<void()> cancel) {
+    _reserve = move(reserve);
+    _publish = move(publish);
+    _cancel = move(cancel);
+    for (int i = 0; i < max(1, workers); ++i) {
+        _workers.emplace_back(&ConnectionFactory::workerTask, this);
+    }
+}
+
+void ConnectionFactory::join() {
+    for (thread& t : _workers) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    _workers.clear();
+}
+
+// 工作线程：预占名额 -> 锁外握手 -> 交付或归还名额
+void ConnectionFactory::workerTask() {
+    while (_reserve()) {
+        Connection* p = create();
+        if (p != nullptr) {
+            _publish(p);
+        } else {
+            _cancel();
+        }
+    }
+}
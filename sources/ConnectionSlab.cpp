@@ -0,0 +1,49 @@
+#include "ConnectionSlab.h"
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+ConnectionSlab::ConnectionSlab(size_t capacity)
+    : _capacity(capacity)
+    , _slots(new Slot[capacity])
+    , _free(capacity)
+{
+    for (size_t i = 0; i < _capacity; ++i) {
+        _free.push(reinterpret_cast<Connection*>(_slots[i].bytes));
+    }
+}
+
+// 取空闲槽位：入队进行中的槽位可能让空闲队列短暂显示为空，让出CPU重试后仍为空才认为用尽
+Connection* ConnectionSlab::allocate() {
+    Connection* slot = nullptr;
+    bool popped = false;
+    for (int retry = 0; retry < 64 && !(popped = _free.pop(slot)); ++retry) {
+        std::this_thread::yield();
+    }
+    if (!popped) {
+        throw std::runtime_error("Connection slab exhausted");
+    }
+
+    try {
+        return new (slot) Connection();
+    } catch (...) {
+        release(slot);
+        throw;
+    }
+}
+
+void ConnectionSlab::deallocate(Connection* p) {
+    if (p == nullptr) {
+        return;
+    }
+    p->~Connection();
+    release(p);
+}
+
+// 归还槽位：同时存在的槽位不超过容量，空闲队列不会真的满；
+// 出队进行中的位置可能让入队暂时失败，此时让出CPU重试直到成功，槽位不会丢失
+void ConnectionSlab::release(Connection* slot) {
+    while (!_free.push(slot)) {
+        std::this_thread::yield();
+    }
+}
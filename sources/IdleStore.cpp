@@ -0,0 +1,105 @@
+#include "IdleStore.h"
+#include <thread>
+
+IdleStore::IdleStore(size_t capacity, IdleOrder order)
+    : _order(order)
+    , _capacity(capacity)
+{
+    if (_order == IdleOrder::FIFO) {
+        _ring.reset(new LockFreeRing<Connection*>(capacity));
+    }
+}
+
+bool IdleStore::push(Connection* p) {
+    if (_order == IdleOrder::FIFO) {
+        return _ring->push(p);
+    }
+
+    lock_guard<mutex> lock(_stackMutex);
+    if (_stack.size() >= _capacity) {
+        return false;
+    }
+    _stack.push_back(p);
+    return true;
+}
+
+bool IdleStore::pop(Connection*& p) {
+    if (_order == IdleOrder::FIFO) {
+        return _ring->pop(p);
+    }
+
+    lock_guard<mutex> lock(_stackMutex);
+    if (_stack.empty()) {
+        return false;
+    }
+    p = _stack.back();
+    _stack.pop_back();
+    return true;
+}
+
+bool IdleStore::pushCold(Connection* p) {
+    if (_order == IdleOrder::FIFO) {
+        return _ring->push(p);
+    }
+
+    lock_guard<mutex> lock(_stackMutex);
+    if (_stack.size() >= _capacity) {
+        return false;
+    }
+    _stack.push_front(p);
+    return true;
+}
+
+size_t IdleStore::evictCold(const function<bool(Connection*)>& expired, size_t maxCount,
+                            vector<Connection*>& out) {
+    size_t evicted = 0;
+
+    if (_order == IdleOrder::LIFO) {
+        // 归还时间不一定单调(保活检测后放回冷端)，检查整个栈而不是遇到未超时的就停止
+        lock_guard<mutex> lock(_stackMutex);
+        auto keep = _stack.begin();
+        for (auto it = _stack.begin(); it != _stack.end(); ++it) {
+            if (evicted < maxCount && expired(*it)) {
+                out.push_back(*it);
+                evicted++;
+            } else {
+                *keep++ = *it;
+            }
+        }
+        _stack.erase(keep, _stack.end());
+        return evicted;
+    }
+
+    size_t n = _ring->size();
+    for (size_t i = 0; i < n; ++i) {
+        Connection* p = nullptr;
+        if (!_ring->pop(p)) {
+            break;
+        }
+        if (evicted < maxCount && expired(p)) {
+            out.push_back(p);
+            evicted++;
+            continue;
+        }
+
+        // 放回队尾；出队进行中的槽位可能让队列短暂显示已满
+        bool pushed = false;
+        for (int retry = 0; retry < 64 && !(pushed = _ring->push(p)); ++retry) {
+            this_thread::yield();
+        }
+        if (!pushed) {
+            out.push_back(p);  // 确实已满，交由调用方销毁
+            evicted++;
+        }
+    }
+    return evicted;
+}
+
+size_t IdleStore::size() const {
+    if (_order == IdleOrder::FIFO) {
+        return _ring->size();
+    }
+
+    lock_guard<mutex> lock(_stackMutex);
+    return _stack.size();
+}
@@ -0,0 +1,275 @@
+#include "PoolConfig.h"
+#include "public.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <iostream>
+
+namespace {
+bool parseBool(const string& value) {
+    string v = value;
+    transform(v.begin(), v.end(), v.begin(), ::tolower);
+    return v == "true" || v == "1" || v == "yes" || v == "on";
+}
+
+// 解析校验策略：true按是否配置validation_query选择query或ping，false等同never
+bool parseValidationPolicy(const string& value, const string& query, ValidationPolicy& policy) {
+    string v = value;
+    transform(v.begin(), v.end(), v.begin(), ::tolower);
+    if (v == "never" || v == "false" || v == "0" || v == "off") policy = ValidationPolicy::Never;
+    else if (v == "idle") policy = ValidationPolicy::IdleTime;
+    else if (v == "ping") policy = ValidationPolicy::Ping;
+    else if (v == "query") policy = ValidationPolicy::Query;
+    else if (v == "true" || v == "1" || v == "on") {
+        policy = query.empty() ? ValidationPolicy::Ping : ValidationPolicy::Query;
+    }
+    else return false;
+    return true;
+}
+}
+
+const char* validationPolicyName(ValidationPolicy policy) {
+    switch (policy) {
+    case ValidationPolicy::Never:    return "never";
+    case ValidationPolicy::IdleTime: return "idle";
+    case ValidationPolicy::Ping:     return "ping";
+    case ValidationPolicy::Query:    return "query";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief 从配置文件加载连接池配置
+ * @param path 配置文件路径
+ * @return bool 加载成功返回true，失败返回false
+ * @note 配置文件格式为`key=value`, 支持#注释和[section]
+ *       支持的配置项有：ip, port, username, password, dbname, initsize, maxsize, maxidletime,
+ *       thread_cache, thread_cache_idle_time, shard_count, idle_order,
+ *       test_on_borrow, test_on_return, validation_query, validation_idle_time,
+ *       reserve_interactive, reserve_normal, connect_workers,
+ *       warmup_concurrency, async_startup, min_idle, auto_size, shrink_delay, sizing_interval,
+ *       keepalive_time, coarse_clock, max_lifetime, lifetime_jitter,
+ *       breaker_failures, breaker_open_time, connect_backoff_base, connect_backoff_max,
+ *       connect_rate, connect_burst, reload_on_sighup, stmt_cache_size
+ *       连接池的初始大小、最大大小、最大空闲时间等 
+ */
+bool PoolConfig::load(const string& path) {
+    FILE *pf = fopen(path.c_str(), "r");
+    if (pf == nullptr) {
+        LOG(path << " file is not exist!");
+        return false;
+    }
+
+    char line[1024];
+    int lineNum = 0;
+    bool hasError = false;
+    string borrowPolicy, returnPolicy;  // 依赖validation_query，读完全文后再解析
+
+    while (fgets(line, sizeof(line), pf)) {
+        lineNum++;
+        string str = line;
+
+        // 去除行尾换行符和回车符
+        str.erase(str.find_last_not_of("\r\n") + 1);
+
+        // 去除行首空白
+        str.erase(0, str.find_first_not_of(" \t"));
+
+        // 跳过空行和注释行
+        if (str.empty() || str[0] == '#') {
+            continue;
+        }
+
+        // 跳过段落标识符（例如 [client], [pool]）
+        if (str.front() == '[' && str.back() == ']') {
+            continue;
+        }
+
+        // 查找并去除行内注释
+        size_t commentPos = str.find('#');
+        if (commentPos != string::npos) {
+            str = str.substr(0, commentPos);
+            str.erase(str.find_last_not_of(" \t") + 1);
+        }
+
+        if (str.empty()) {
+            continue;
+        }
+
+        // 解析键值对
+        size_t eq_pos = str.find('=');
+        if (eq_pos == string::npos) {
+            LOG("Config syntax error at line " << lineNum << ": missing '='");
+            hasError = true;
+            continue;
+        }
+
+        string key = str.substr(0, eq_pos);
+        string value = str.substr(eq_pos + 1);
+
+        // 去除键和值的首尾空白
+        key.erase(0, key.find_first_not_of(" \t"));
+        key.erase(key.find_last_not_of(" \t") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t") + 1);
+
+        // 字段名统一转为小写
+        transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+        // 处理配置项：数值非法(stoi/stod抛出异常)时记录错误并继续读取，不让异常传出load()
+        try {
+            if (key == "ip" || key == "host") ip = value;
+            else if (key == "port") port = stoi(value);
+            else if (key == "username" || key == "user") username = value;
+            else if (key == "password") password = value;
+            else if (key == "dbname" || key == "database") dbname = value;
+            else if (key == "initsize" || key == "initial_size") initSize = stoi(value);
+            else if (key == "maxsize" || key == "max_size") maxSize = stoi(value);
+            else if (key == "maxidletime" || key == "max_idle_time") maxIdleTime = stoi(value);
+            else if (key == "connectiontimeout" || key == "connect_timeout") connectionTimeout = stoi(value);
+            else if (key == "thread_cache") threadCacheEnabled = parseBool(value);
+            else if (key == "thread_cache_idle_time") threadCacheIdleTime = stoi(value);
+            else if (key == "shard_count") shardCount = stoi(value);
+            else if (key == "idle_order") {
+                transform(value.begin(), value.end(), value.begin(), ::tolower);
+                if (value == "fifo") idleOrder = IdleOrder::FIFO;
+                else if (value == "lifo") idleOrder = IdleOrder::LIFO;
+                else {
+                    LOG("Config error at line " << lineNum << ": idle_order must be fifo or lifo");
+                    hasError = true;
+                }
+            }
+            else if (key == "test_on_borrow") borrowPolicy = value;
+            else if (key == "test_on_return") returnPolicy = value;
+            else if (key == "validation_query") validationQuery = value;
+            else if (key == "validation_idle_time") validationIdleTime = stoi(value);
+            else if (key == "reserve_interactive") reserveInteractive = stoi(value);
+            else if (key == "reserve_normal") reserveNormal = stoi(value);
+            else if (key == "connect_workers") connectWorkers = stoi(value);
+            else if (key == "warmup_concurrency") warmupConcurrency = stoi(value);
+            else if (key == "async_startup") asyncStartup = parseBool(value);
+            else if (key == "min_idle") minIdle = stoi(value);
+            else if (key == "auto_size") autoSize = parseBool(value);
+            else if (key == "shrink_delay") shrinkDelay = stoi(value);
+            else if (key == "sizing_interval") sizingInterval = stoi(value);
+            else if (key == "keepalive_time") keepaliveTime = stoi(value);
+            else if (key == "coarse_clock") coarseClock = parseBool(value);
+            else if (key == "max_lifetime") maxLifetime = stoi(value);
+            else if (key == "lifetime_jitter") lifetimeJitter = stoi(value);
+            else if (key == "breaker_failures") breakerFailures = stoi(value);
+            else if (key == "breaker_open_time") breakerOpenTime = stoi(value);
+            else if (key == "connect_backoff_base") connectBackoffBase = stoi(value);
+            else if (key == "connect_backoff_max") connectBackoffMax = stoi(value);
+            else if (key == "connect_rate") connectRate = stod(value);
+            else if (key == "connect_burst") connectBurst = stoi(value);
+            else if (key == "reload_on_sighup") reloadOnSighup = parseBool(value);
+            else if (key == "stmt_cache_size") stmtCacheSize = stoi(value);
+            else {
+                LOG("Warning: Unknown config key '" << key << "' at line " << lineNum);
+            }
+        } catch (const exception&) {
+            LOG("Config error at line " << lineNum << ": invalid value '" << value << "' for '" << key << "'");
+            hasError = true;
+        }
+    }
+
+    fclose(pf);
+
+    // 解析借出/归还校验策略
+    if (!borrowPolicy.empty() &&
+        !parseValidationPolicy(borrowPolicy, validationQuery, borrowValidation)) {
+        LOG("Error: test_on_borrow must be one of never/idle/ping/query/true/false");
+        hasError = true;
+    }
+    if (!returnPolicy.empty() &&
+        !parseValidationPolicy(returnPolicy, validationQuery, returnValidation)) {
+        LOG("Error: test_on_return must be one of never/idle/ping/query/true/false");
+        hasError = true;
+    }
+
+    return !hasError;
+}
+
+// 检查配置是否完整、取值是否合法
+bool PoolConfig::validate() const {
+    bool hasError = false;
+
+    // 验证必要配置
+    if (ip.empty()) {
+        LOG("Error: Missing required configuration 'ip' or 'host'");
+        hasError = true;
+    }
+    if (username.empty()) {
+        LOG("Error: Missing required configuration 'username' or 'user'");
+        hasError = true;
+    }
+    if (dbname.empty()) {
+        LOG("Error: Missing required configuration 'dbname' or 'database'");
+        hasError = true;
+    }
+
+    // 验证数值范围
+    if (initSize <= 0 || maxSize <= 0 || initSize > maxSize) {
+        LOG("Error: Invalid pool size configuration");
+        hasError = true;
+    }
+    if ((borrowValidation == ValidationPolicy::Query ||
+         returnValidation == ValidationPolicy::Query) && validationQuery.empty()) {
+        LOG("Error: Validation policy 'query' requires 'validation_query'");
+        hasError = true;
+    }
+    if (reserveInteractive < 0 || reserveNormal < 0) {
+        LOG("Error: Priority reservation must not be negative");
+        hasError = true;
+    }
+    if (reserveInteractive + reserveNormal >= maxSize) {
+        LOG("Error: Total reserved connections must be less than max_size");
+        hasError = true;
+    }
+    if (connectWorkers <= 0) {
+        LOG("Error: connect_workers must be positive");
+        hasError = true;
+    }
+    if (warmupConcurrency <= 0) {
+        LOG("Error: warmup_concurrency must be positive");
+        hasError = true;
+    }
+    if (minIdle < 0 || minIdle > maxSize) {
+        LOG("Error: min_idle must be between 0 and max_size");
+        hasError = true;
+    }
+    if (shrinkDelay < 0 || sizingInterval <= 0) {
+        LOG("Error: shrink_delay must not be negative and sizing_interval must be positive");
+        hasError = true;
+    }
+    if (keepaliveTime < 0) {
+        LOG("Error: keepalive_time must not be negative");
+        hasError = true;
+    }
+    if (maxLifetime < 0) {
+        LOG("Error: max_lifetime must not be negative");
+        hasError = true;
+    }
+    if (lifetimeJitter < 0 || lifetimeJitter >= 100) {
+        LOG("Error: lifetime_jitter must be between 0 and 99");
+        hasError = true;
+    }
+    if (breakerFailures < 0 || breakerOpenTime <= 0) {
+        LOG("Error: breaker_failures must not be negative and breaker_open_time must be positive");
+        hasError = true;
+    }
+    if (connectBackoffBase <= 0 || connectBackoffMax < connectBackoffBase) {
+        LOG("Error: connect_backoff_base must be positive and not greater than connect_backoff_max");
+        hasError = true;
+    }
+    if (connectRate < 0 || connectBurst <= 0) {
+        LOG("Error: connect_rate must not be negative and connect_burst must be positive");
+        hasError = true;
+    }
+    if (stmtCacheSize <= 0) {
+        LOG("Error: stmt_cache_size must be positive");
+        hasError = true;
+    }
+
+    return !hasError;
+}
@@ -0,0 +1,50 @@
+#include "TimerQueue.h"
+#include "public.h"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+bool TimerQueue::schedule(Clock::time_point when, Task task) {
+    lock_guard<mutex> lock(_mutex);
+    bool earliest = _heap.empty() || when < _heap.front().when;
+    _heap.push_back(Entry{when, _seq++, move(task)});
+    push_heap(_heap.begin(), _heap.end(), Later());
+    return earliest;
+}
+
+size_t TimerQueue::runDue(Clock::time_point now) {
+    // 先取出所有到期任务再逐个执行，任务执行期间不持有锁
+    vector<Entry> due;
+    {
+        lock_guard<mutex> lock(_mutex);
+        while (!_heap.empty() && _heap.front().when <= now) {
+            pop_heap(_heap.begin(), _heap.end(), Later());
+            due.push_back(move(_heap.back()));
+            _heap.pop_back();
+        }
+    }
+
+    for (Entry& e : due) {
+        // 任务抛出异常时记录日志并不再登记，避免异常终止维护线程(进而终止进程)
+        Clock::time_point next = Clock::time_point::max();
+        try {
+            next = e.task(now);
+        } catch (const exception& ex) {
+            LOG("维护任务异常，已停止该任务: " << ex.what());
+        }
+        if (next != Clock::time_point::max()) {
+            schedule(next, move(e.task));
+        }
+    }
+    return due.size();
+}
+
+TimerQueue::Clock::time_point TimerQueue::nextDeadline() const {
+    lock_guard<mutex> lock(_mutex);
+    return _heap.empty() ? Clock::time_point::max() : _heap.front().when;
+}
+
+void TimerQueue::clear() {
+    lock_guard<mutex> lock(_mutex);
+    _heap.clear();
+}
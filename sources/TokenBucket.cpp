@@ -0,0 +1,62 @@
+#include "TokenBucket.h"
+#include <algorithm>
+
+void TokenBucket::configure(double rate, int burst) {
+    Clock::time_point now = Clock::now();
+    if (_configured) {
+        // 先按旧速率补充到当前时刻，再截断到新容量
+        if (!unlimited()) {
+            refill(now);
+        }
+        _burst = max(1, burst);
+        _tokens = min(_tokens, _burst);
+    } else {
+        _burst = max(1, burst);
+        _tokens = _burst;
+        _configured = true;
+    }
+    _rate = rate;
+    _last = now;
+}
+
+void TokenBucket::refill(Clock::time_point now) {
+    if (now <= _last) {
+        return;
+    }
+    double elapsed = chrono::duration<double>(now - _last).count();
+    _tokens = min(_burst, _tokens + elapsed * _rate);
+    _last = now;
+}
+
+TokenBucket::Clock::time_point TokenBucket::availableAt(Clock::time_point now) {
+    if (unlimited()) {
+        return now;
+    }
+    refill(now);
+    if (_tokens >= 1) {
+        return now;
+    }
+    // 向上取整到纳秒，保证到时后refill()一定补足一个令牌
+    auto wait = chrono::duration<double>((1 - _tokens) / _rate);
+    return now + chrono::ceil<Clock::duration>(wait);
+}
+
+bool TokenBucket::tryTake(Clock::time_point now) {
+    if (unlimited()) {
+        return true;
+    }
+    refill(now);
+    if (_tokens < 1) {
+        return false;
+    }
+    _tokens -= 1;
+    return true;
+}
+
+double TokenBucket::tokens(Clock::time_point now) const {
+    if (unlimited() || now <= _last) {
+        return _tokens;
+    }
+    double elapsed = chrono::duration<double>(now - _last).count();
+    return min(_burst, _tokens + elapsed * _rate);
+}
@@ -275,6 +275,206 @@ void testWithConnectionPool(int insertTimes) {
     LOG("With Connection Pool, Total Time: " << duration.count() << " ms");
 }
 
+// 借用开销对比：只借出/归还不执行SQL，比较shared_ptr接口与PooledConnection句柄的单次开销
+void testBorrowOverhead(int iterations) {
+    LOG("Test: Borrow Overhead");
+    ConnectionPool* pool = ConnectionPool::getConnectionPool();
+
+    // 预热：让连接池建好连接，避免把建连时间计入
+    for (int i = 0; i < 1000; ++i) {
+        auto conn = pool->getConnection();
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        shared_ptr<Connection> conn = pool->getConnection();
+        if (!conn) {
+            LOG("shared_ptr 第 " << i << " 次获取连接失败");
+        }
+    }
+    auto sharedNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        PooledConnection conn = pool->borrowConnection();
+        if (!conn) {
+            LOG("PooledConnection 第 " << i << " 次获取连接失败");
+        }
+    }
+    auto handleNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    LOG("shared_ptr<Connection>: " << sharedNs / iterations << " ns/borrow");
+    LOG("PooledConnection:       " << handleNs / iterations << " ns/borrow");
+    pool->printStats();
+
+    // 时钟开销对比：启用线程缓存且不做校验时借出/归还几乎只剩时间戳读取，比较steady_clock与coarse_clock
+    PoolConfig config;
+    if (!config.load("mysql.cnf")) {
+        return;
+    }
+    config.threadCacheEnabled = true;
+    config.borrowValidation = ValidationPolicy::Never;
+    config.returnValidation = ValidationPolicy::Never;
+    ConnectionPool cached(config);
+    bool coarse = PoolClock::coarse();
+    for (bool mode : {false, true}) {
+        PoolClock::setCoarse(mode);
+        for (int i = 0; i < 1000; ++i) {
+            PooledConnection conn = cached.borrowConnection();
+        }
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            PooledConnection conn = cached.borrowConnection();
+        }
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        LOG((mode ? "coarse_clock: " : "steady_clock: ") << ns / iterations << " ns/borrow (thread cache)");
+    }
+    PoolClock::setCoarse(coarse);
+}
+
+/**
+ * @brief 并行建连：冷启动的连接池同时来borrowers个借用方，比较connect_workers为1和4时的最长等待
+ * @note 结果取决于握手耗时；本机MySQL可用tc netem给回环网卡加延迟模拟远端数据库，
+ *       例如 tc qdisc add dev lo root netem delay 5ms (握手约20ms)
+ */
+void testParallelConnect(int borrowers) {
+    LOG("Test: Parallel Connect");
+    for (int workers : {1, 4}) {
+        PoolConfig config;
+        if (!config.load("mysql.cnf")) {
+            return;
+        }
+        config.initSize = 1;
+        config.maxSize = max(config.maxSize, borrowers + 1);
+        config.connectWorkers = workers;
+        ConnectionPool pool(config);
+
+        atomic<long long> worstUs(0);
+        vector<thread> threads;
+        for (int i = 0; i < borrowers; ++i) {
+            threads.emplace_back([&pool, &worstUs] {
+                auto start = chrono::steady_clock::now();
+                PooledConnection conn = pool.borrowConnection();
+                long long us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+                long long worst = worstUs.load();
+                while (us > worst && !worstUs.compare_exchange_weak(worst, us)) {
+                }
+                // 持有到所有借用方都拿到连接，保证每个借用方都需要一个自己的连接
+                this_thread::sleep_for(chrono::milliseconds(500));
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        LOG("connect_workers=" << workers << ": " << borrowers << " borrowers, worst wait "
+            << worstUs / 1000 << " ms");
+    }
+}
+
+/**
+ * @brief 启动预热：比较warmup_concurrency为1和8时建立initial_size个连接的构造耗时，
+ *        以及异步启动(async_startup)时构造耗时和第一次借用成功的时间
+ * @note 与testParallelConnect相同，可用tc netem模拟握手耗时(提交说明中的数字是握手约50ms时测得)
+ */
+void testWarmUp(int initSize) {
+    LOG("Test: Warm-up");
+    PoolConfig config;
+    if (!config.load("mysql.cnf")) {
+        return;
+    }
+    config.initSize = initSize;
+    config.maxSize = max(config.maxSize, initSize);
+
+    for (int concurrency : {1, 8}) {
+        config.warmupConcurrency = concurrency;
+        config.asyncStartup = false;
+        auto start = chrono::steady_clock::now();
+        ConnectionPool pool(config);
+        auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        LOG("warmup_concurrency=" << concurrency << ": constructed " << initSize << " connections in " << ms << " ms");
+    }
+
+    config.warmupConcurrency = 8;
+    config.asyncStartup = true;
+    auto start = chrono::steady_clock::now();
+    ConnectionPool pool(config);
+    auto ctorMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    PooledConnection conn = pool.borrowConnection();
+    auto firstMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    LOG("async_startup: constructor " << ctorMs << " ms, first borrow " << (conn ? "after " : "failed after ")
+        << firstMs << " ms");
+}
+
+/**
+ * @brief 后端故障期间的断路器：8个线程持续借用，中途把连接池重新加载到一个不可达的端口
+ *        模拟MySQL停机outageMs毫秒，再恢复原配置
+ * @details 统计故障期间借用失败的次数与最长失败耗时、建连失败次数(printStats中的"建连失败")，
+ *          以及恢复后第一次借用成功所需的时间。没有断路器时每个借用方都要等满超时，
+ *          建连线程会不停重试
+ * @note 端口1在本机通常没有监听，建连立即被拒绝
+ */
+void testBreakerOutage(int outageMs) {
+    LOG("Test: Breaker Outage");
+    PoolConfig config;
+    if (!config.load("mysql.cnf")) {
+        return;
+    }
+    // 建连失败按connect_backoff_base指数退避，较短的故障内达到断开阈值需要降低阈值
+    config.breakerFailures = 3;
+    config.breakerOpenTime = 200;
+    ConnectionPool pool(config);
+
+    atomic<bool> stop(false);
+    atomic<int> ok(0), failed(0), unavailable(0);
+    atomic<long long> worstFailUs(0);
+    vector<thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&] {
+            while (!stop) {
+                auto start = chrono::steady_clock::now();
+                PooledConnection conn = pool.borrowConnection(chrono::milliseconds(1000));
+                long long us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+                if (conn) {
+                    ok++;
+                } else {
+                    failed++;
+                    if (ConnectionPool::lastError() == PoolError::BackendUnavailable) {
+                        unavailable++;
+                    }
+                    long long worst = worstFailUs.load();
+                    while (us > worst && !worstFailUs.compare_exchange_weak(worst, us)) {
+                    }
+                }
+                this_thread::sleep_for(chrono::microseconds(100));
+            }
+        });
+    }
+
+    this_thread::sleep_for(chrono::milliseconds(200));
+    PoolConfig down = pool.getConfig();
+    down.port = 1;
+    pool.reload(down);
+    this_thread::sleep_for(chrono::milliseconds(outageMs));
+    LOG("故障期间:");
+    pool.printStats();
+
+    int okBefore = ok;
+    auto upAt = chrono::steady_clock::now();
+    pool.reload(config);
+    while (ok == okBefore && chrono::steady_clock::now() - upAt < chrono::seconds(10)) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    auto recoverMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - upAt).count();
+    stop = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    LOG("borrow failures " << failed << " (backend unavailable " << unavailable << "), worst failure "
+        << worstFailUs / 1000 << " ms, recovered in " << recoverMs << " ms");
+    pool.printStats();
+}
+
 int main() {
 
     if  (0) {
@@ -301,6 +501,14 @@ int main() {
         testConcurrentInsertPressure(threadCount, insertPerThread);
         LOG("测试完毕")
         //selectUserTable();
+    } else if (0) {
+        testBorrowOverhead(1000000);
+    } else if (0) {
+        testParallelConnect(16);
+    } else if (0) {
+        testWarmUp(16);
+    } else if (0) {
+        testBreakerOutage(500);
     } else {
         const int insertTimes = 10000;
         testWithoutConnectionPool(insertTimes);